@@ -1,6 +1,7 @@
 #pragma once
 
 #include "common.h"
+#include "outofcore.h"
 
 /**
  * Run Adaptive Mesh Refinement using
@@ -11,3 +12,13 @@
  * @return the results in an {@code AMROutput} struct
  */
 AMROutput run(AMRInput* input, float affect_rate, float epsilon);
+
+/**
+ * Run Adaptive Mesh Refinement out of core, streaming the
+ * topology of the given grid from disk every iteration.
+ * Returns results, along with the I/O bandwidth of the sweeps.
+ *
+ * @param grid pointer to opened {@code OutOfCoreGrid} struct
+ * @return the results in an {@code AMROutput} struct
+ */
+AMROutput runOutOfCore(OutOfCoreGrid* grid, float affect_rate, float epsilon);
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <stddef.h>
+
+/**
+ * Alignment of every arena allocation (one cache line)
+ */
+#define ARENA_ALIGNMENT 64
+
+/**
+ * Default size of the blocks backing an arena.
+ * Blocks are anonymous mappings, so pages that are
+ * never touched do not take up memory.
+ */
+#define ARENA_BLOCK_SIZE (64 << 20)
+
+/**
+ * Environment variable selecting the pages behind arena blocks:
+ *
+ * {@code thp} (or 1) - blocks aligned to {@code HUGE_PAGE_SIZE} and advised
+ *                      for transparent huge pages ({@code MADV_HUGEPAGE})
+ * {@code hugetlb}    - blocks from the explicit huge page pool
+ *                      ({@code MAP_HUGETLB}), falling back to {@code thp}
+ *                      when the pool can not cover a block
+ * unset/empty/0      - regular pages
+ *
+ * The kernel may still back blocks with regular pages
+ * (e.g. when transparent huge pages are disabled).
+ */
+#define HUGE_PAGES_ENV "AMR_HUGE_PAGES"
+
+/**
+ * Size and alignment of huge-page backed blocks
+ */
+#define HUGE_PAGE_SIZE (2 << 20)
+
+typedef enum { HUGE_PAGES_OFF=0, HUGE_PAGES_THP, HUGE_PAGES_HUGETLB } HugePageMode;
+
+/**
+ * Reads the page mode from {@code HUGE_PAGES_ENV}.
+ * Exits with an error message on an unknown mode.
+ *
+ * @return the page mode, {@code HUGE_PAGES_OFF} if none is set
+ */
+HugePageMode hugePageMode();
+
+/**
+ * Block of memory handed out by an arena
+ *
+ * {@code next} - previously filled block
+ * {@code size} - size of the block, including this header
+ * {@code used} - bytes handed out so far, including this header
+ */
+typedef struct ArenaBlock {
+    struct ArenaBlock* next;
+    size_t             size;
+    size_t             used;
+} ArenaBlock;
+
+/**
+ * Bump allocator: allocations are carved out of large blocks
+ * and can only be released all at once.
+ */
+typedef struct Arena {
+    ArenaBlock* head;
+    size_t      block_size;
+    void*       last;
+} Arena;
+
+/**
+ * Creates an arena. The {@code Arena} struct itself
+ * lives in the arena's first block.
+ * Should be paired with {@code destroyArena}.
+ *
+ * @param block_size minimum size of the blocks backing the arena
+ * @return the created {@code Arena}
+ */
+Arena* createArena(size_t block_size);
+
+/**
+ * Allocates {@code bytes} bytes, aligned to {@code ARENA_ALIGNMENT}.
+ * Exits with an error message if memory can not be mapped.
+ *
+ * @param arena {@code Arena} to allocate from
+ * @param bytes size of the allocation
+ * @return pointer to the allocation
+ */
+void* arenaAlloc(Arena* arena, size_t bytes);
+
+/**
+ * Shrinks the most recent allocation, so a reservation for an
+ * upper bound can be cut down once the real size is known.
+ * Does nothing if {@code ptr} is not the most recent allocation.
+ *
+ * @param arena {@code Arena} the allocation came from
+ * @param ptr   pointer returned by {@code arenaAlloc}
+ * @param bytes new size of the allocation
+ */
+void arenaTrim(Arena* arena, void* ptr, size_t bytes);
+
+/**
+ * Resizes an allocation that is to grow, in place if it is the most
+ * recent one and its block has room. Otherwise its contents move to a
+ * new allocation with room to grow in place next time, and the pages
+ * of the old one are returned to the system.
+ *
+ * @param arena {@code Arena} the allocation came from
+ * @param ptr   pointer returned by {@code arenaAlloc} or {@code arenaGrow},
+ *              no longer valid afterwards
+ * @param used  bytes of the allocation in use, kept when it moves
+ * @param bytes new size of the allocation
+ * @return pointer to the resized allocation
+ */
+void* arenaGrow(Arena* arena, void* ptr, size_t used, size_t bytes);
+
+/**
+ * Releases every allocation of the arena (and the arena itself).
+ *
+ * @param arena {@code Arena} returned by {@code createArena}
+ */
+void destroyArena(Arena* arena);
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <stddef.h>
+#include <stdio.h>
 #include <time.h>
 
 typedef unsigned int Count;
@@ -9,24 +11,44 @@ typedef double       DSV;
 #define COORD_SPEC "%u"
 #define DSV_SPEC "%lf"
 
-typedef struct BoxData {
-    Coord perimeter;
-    Count id;
+/**
+ * Offsets into the per-neighbor arrays and neighbor totals.
+ * 32-bit by default, building with {@code WIDE_OFFSETS=1} (see the Makefile)
+ * makes them 64-bit for grids with 4G or more neighbor entries.
+ * Box ids (and so {@code nhbr_ids}) stay {@code Count}.
+ */
+#ifndef WIDE_OFFSETS
+#define WIDE_OFFSETS 0
+#endif
+#if (WIDE_OFFSETS != 0)
+typedef unsigned long long Offset;
+#define OFFSET_SPEC "%llu"
+#else
+typedef unsigned int Offset;
+#define OFFSET_SPEC "%u"
+#endif
 
-    Count  num_nhbrs;
-    Count* nhbr_ids;
-    Coord* overlaps;
-    Coord  self_overlap;
+/**
+ * Precomputed update weights (see {@code computeWeightRange()}).
+ * Doubles by default, building with {@code FLOAT_WEIGHTS=1} (see the Makefile)
+ * stores them as floats, halving the per-neighbor weight traffic.
+ * DSVs and the sums over neighbors stay {@code DSV}.
+ */
+#ifndef FLOAT_WEIGHTS
+#define FLOAT_WEIGHTS 0
+#endif
+#if (FLOAT_WEIGHTS != 0)
+typedef float Weight;
+#else
+typedef double Weight;
+#endif
 
-    /**
-     * Unnecessary, since boxes currently
-     * aren't adaptive
-     */
-    //Coord x;
-    //Coord y;
-    //Coord height;
-    //Coord width;
-} BoxData;
+/**
+ * Extent of a box on the grid
+ */
+typedef struct BoxBounds {
+    Coord x_min, x_max, y_min, y_max;
+} BoxBounds;
 
 typedef struct AMRInput {
     /**
@@ -40,34 +62,120 @@ typedef struct AMRInput {
     Coord rows, cols;
 
     /**
-     * Per-box data
+     * Per-box data, in structure-of-arrays (CSR) form:
+     * box i's neighbors are {@code nhbr_ids}/{@code overlaps}
+     * [offsets[i], offsets[i] + num_nhbrs[i]).
+     * Every array starts on a 64-byte boundary (see {@code ARENA_ALIGNMENT}
+     * and {@code AMRB_ALIGNMENT}).
      */
-    BoxData* boxes;
+    Coord*   perimeters;
+    Count*   num_nhbrs;
+    Offset*  offsets;
+    Coord*   self_overlaps;
+    Offset   total_nhbrs;
+    Count*   nhbr_ids;
+    Coord*   overlaps;
     DSV*     vals;
+
+    /**
+     * Box extents, kept so grids can be changed
+     * in place (see {@code delta.h})
+     */
+    BoxBounds* bounds;
+
+    /**
+     * Id each box had when loaded, {@code NULL} unless the
+     * grid was renumbered (see {@code reorder.h})
+     */
+    Count* order;
+
+    /**
+     * Arena holding this struct and all of its arrays
+     */
+    struct Arena* arena;
+
+    /**
+     * Buffer the topology arrays point into when
+     * loaded from a compiled binary grid, {@code NULL} otherwise
+     */
+    struct InputBuffer* source;
+
+    /**
+     * Parse statistics:
+     *
+     * {@code parse_bytes}   - size of the input in bytes
+     * {@code parse_seconds}   - wall-clock time spent in {@code parseInput()}
+     * {@code overlap_seconds} - part of it spent computing overlaps,
+     *                           0 when the topology was loaded precomputed
+     */
+    size_t parse_bytes;
+    double parse_seconds;
+    double overlap_seconds;
 } AMRInput;
 
 /**
- * Parses Adaptive Mesh Refinement input from stdin.
+ * Parses Adaptive Mesh Refinement input from the given file.
  * Allocates and populates an {@code AMRInput} struct to hold the input.
  * Should be paired with {@code destroyAMRInput}.
  *
+ * @param file_name   path of the input file, or {@code NULL} to read from stdin
+ * @param num_threads number of threads for the overlap stage
  * @return the allocated/populated {@code AMRInput} struct
  */
-AMRInput* parseInput();
+AMRInput* parseInput(const char* file_name, Count num_threads);
 
 /**
  * Destroys input created with {@code parseInput()}.
- * Deallocates all allocations from {@code parseInput()}.
+ * Deallocates all allocations from {@code parseInput()} by releasing its arena.
  * Should be paired with {@code parseInput()}.
  *
  * @param input pointer to {@code AMRInput} returned by {@code parseInput()}
  */
 void destroyInput(AMRInput* input);
 
+/**
+ * Folds the affect rate, perimeter, self-overlap and overlaps of boxes
+ * [{@code start}, {@code end}) into one weight per box and one per neighbor,
+ * so each update is a plain sparse dot product:
+ *
+ * new DSV of box i = diag_weights[i] * vals[i]
+ *                  + sum over its row of nhbr_weights[k] * vals[nhbr_ids[k]]
+ *
+ * diag_weights[i] = (1 - affect_rate) + affect_rate * self_overlaps[i] / perimeters[i]
+ * nhbr_weights[k] = affect_rate * overlaps[k] / perimeters[i]
+ *
+ * @param input        pointer to populated {@code AMRInput} struct
+ * @param affect_rate  affect rate of the run
+ * @param start        first box
+ * @param end          one past the last box
+ * @param diag_weights room for {@code N} weights (only [start, end) is written)
+ * @param nhbr_weights room for {@code total_nhbrs} weights, laid out like {@code nhbr_ids}
+ */
+void computeWeightRange(const AMRInput* input, float affect_rate, Count start, Count end,
+                        Weight* diag_weights, Weight* nhbr_weights);
+
 typedef struct AMRMaxMin {
     DSV max;
     DSV min;
 } AMRMaxMin;
+/**
+ * Helper function for computing the maximum and minimum
+ * of {@code N} DSVs
+ *
+ * @param N    number of DSVs
+ * @param vals the DSVs
+ * @return struct with maximum and minimum DSV
+ */
+static inline AMRMaxMin getDSVMaxMin(Count N, const DSV* vals) {
+    AMRMaxMin result = { vals[0], vals[0] };
+    for (Count i = 1; i < N; ++i) {
+        DSV val = vals[i];
+        result.max = (val > result.max) ? val : result.max;
+        result.min = (val < result.min) ? val : result.min;
+    }
+    return result;
+}
+
 /**
  * Helper function for computing the maximum and minimum DSV
  *
@@ -75,16 +183,7 @@ typedef struct AMRMaxMin {
  * @return struct with maximum and minimum DSV
  */
 static inline AMRMaxMin getMaxMin(AMRInput* input) {
-    AMRMaxMin result = { input->vals[0], input->vals[0] };
-    for (int i = 1; i < input->N; ++i) {
-        DSV val = input->vals[i];
-        if (val > result.max) {
-            result.max = val;
-        } else if (val < result.min) {
-            result.min = val;
-        }
-    }
-    return result;
+    return getDSVMaxMin(input->N, input->vals);
 }
 
 typedef struct AMROutput {
@@ -99,9 +198,31 @@ typedef struct AMROutput {
     DSV           max;
     DSV           min;
 
+    /**
+     * Mixed-precision runs only, 0 otherwise:
+     * the first iterations, run with float DSVs
+     */
+    unsigned long low_iterations;
+
     double time_seconds;
     double clock_seconds;
     double gettime_seconds;
+
+    size_t parse_bytes;
+    double parse_seconds;
+    double overlap_seconds;
+
+    /**
+     * Out-of-core runs only, 0 otherwise:
+     *
+     * {@code io_bytes}         - topology bytes streamed over all iterations
+     * {@code io_seconds}       - wall-clock time spent prefetching, faulting in
+     *                            and releasing windows (not solving them)
+     * {@code io_worst_seconds} - the same, for the iteration that spent the most
+     */
+    size_t io_bytes;
+    double io_seconds;
+    double io_worst_seconds;
 } AMROutput;
 
 /**
@@ -125,8 +246,8 @@ static inline int min(int a, int b) { return a < b ? a : b; }
  */
 static inline int max(int a, int b) { return a > b ? a : b; }
 
-static void printDSVs(Count N, DSV* vals) {
-    for (int i = 0; i < N; ++i) {
+static inline void printDSVs(Count N, DSV* vals) {
+    for (Count i = 0; i < N; ++i) {
         printf(DSV_SPEC" ", vals[i]);
     }
     printf("\n");
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "common.h"
+
+/**
+ * Environment variable enabling the compact update in {@code amr}
+ * (set to 1), unset or 0 for the CSR update
+ */
+#define COMPACT_ENV "AMR_COMPACT"
+
+/**
+ * Topology with neighbor ids and overlaps narrowed to cut the bytes
+ * read per update. Rows keep the CSR layout of {@code AMRInput}
+ * ({@code offsets}, {@code num_nhbrs}), only the per-neighbor arrays
+ * are replaced:
+ *
+ * {@code N}             - number of boxes
+ * {@code total_nhbrs}   - number of neighbor entries
+ * {@code nhbr_deltas}   - neighbor id minus box id
+ * {@code overlap_bytes} - width of the overlaps, 1 or 2 (picked per grid)
+ * {@code overlaps8}     - overlaps if {@code overlap_bytes} is 1, else {@code NULL}
+ * {@code overlaps16}    - overlaps if {@code overlap_bytes} is 2, else {@code NULL}
+ * {@code diag_weights}  - diagonal weight of each box (see {@code computeWeightRange()})
+ * {@code scales}        - affect rate over perimeter of each box, which turns
+ *                         the box's overlap-weighted sum into its neighbor term
+ *
+ * Neighbors more than 32767 ids away from their box are stored with delta
+ * and overlap 0 (adding nothing), and listed again in full in
+ * {@code far_rows}/{@code far_ids}/{@code far_overlaps} ({@code num_far}
+ * entries in row order), which are added after the rows are summed.
+ * This keeps the row loop free of branches.
+ */
+typedef struct CompactGrid {
+    Count     N;
+    Offset    total_nhbrs;
+    int16_t*  nhbr_deltas;
+    int       overlap_bytes;
+    uint8_t*  overlaps8;
+    uint16_t* overlaps16;
+    Weight*   diag_weights;
+    Weight*   scales;
+
+    Offset    num_far;
+    Count*    far_rows;
+    Count*    far_ids;
+    Coord*    far_overlaps;
+} CompactGrid;
+
+/**
+ * Reads whether {@code COMPACT_ENV} enables the compact update
+ *
+ * @return 1 if enabled, 0 otherwise
+ */
+int compactEnabled();
+
+/**
+ * Encodes a grid's topology compactly
+ *
+ * @param input        pointer to populated {@code AMRInput} struct
+ * @param affect_rate  affect rate of the run
+ * @param diag_weights {@code N} diagonal weights
+ * @param arena        arena the grid is allocated from
+ * @return the encoded grid, or {@code NULL} if an overlap needs more than 16 bits
+ */
+CompactGrid* buildCompactGrid(const AMRInput* input, float affect_rate,
+                              const Weight* diag_weights, struct Arena* arena);
+
+/**
+ * Bytes of topology and weights read by one {@code compactUpdate()}
+ */
+size_t compactBytes(const CompactGrid* compact);
+
+/**
+ * Computes one iteration's updated DSVs
+ *
+ * @param input        pointer to the {@code AMRInput} the grid was encoded from
+ * @param compact      grid encoded by {@code buildCompactGrid()}
+ * @param vals         current DSVs
+ * @param updated_vals room for {@code N} DSVs
+ */
+void compactUpdate(const AMRInput* input, const CompactGrid* compact, const DSV* vals, DSV* updated_vals);
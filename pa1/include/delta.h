@@ -0,0 +1,80 @@
+#pragma once
+
+#include "common.h"
+
+/**
+ * Environment variable naming a delta file applied to every
+ * grid loaded with {@code parseInput()} (unset or empty for none)
+ */
+#define DELTA_ENV "AMR_DELTA"
+
+/**
+ * First token of a delta file, which lists changes to a grid,
+ * one per record, up to a terminating -1:
+ *
+ * delta
+ * change id       (new extent and DSV of an existing box)
+ * y x height width
+ * DSV
+ * add             (new box, gets the next free id)
+ * y x height width
+ * DSV
+ * remove id
+ * dsv id DSV      (new DSV only, topology is untouched)
+ * ...
+ * -1
+ */
+#define DELTA_KEYWORD "delta"
+
+/**
+ * Per-box flags used while a delta is applied
+ */
+#define DELTA_CHANGED 0x1
+#define DELTA_ADDED   0x2
+#define DELTA_REMOVED 0x4
+#define DELTA_POOL    0x8
+
+typedef enum { DELTA_CHANGE=0, DELTA_ADD, DELTA_REMOVE, DELTA_DSV } DeltaKind;
+
+/**
+ * One record of a delta file
+ *
+ * {@code kind}   - type of the record
+ * {@code id}     - box the record applies to (assigned for {@code DELTA_ADD})
+ * {@code bounds} - new extent ({@code DELTA_CHANGE} and {@code DELTA_ADD} only)
+ * {@code val}    - new DSV (all but {@code DELTA_REMOVE})
+ */
+typedef struct DeltaOp {
+    DeltaKind kind;
+    Count     id;
+    BoxBounds bounds;
+    DSV       val;
+} DeltaOp;
+
+/**
+ * Reads the delta file named by {@code DELTA_ENV}.
+ *
+ * @return the delta file, or {@code NULL} if none is set
+ */
+const char* deltaFile();
+
+/**
+ * Applies a delta file to a loaded grid in place.
+ *
+ * Only the neighborhood of the delta is rebuilt: the changed and added
+ * boxes, the old neighbors of changed and removed boxes, and the boxes
+ * touching the new extents are swept with {@code buildAdjacency()}, and
+ * only their rows are recomputed. The CSR arrays are then re-packed into
+ * new arrays in the input's arena (so a mapped compiled grid is never
+ * written), copying every other row as is.
+ * Removed boxes are compacted away by moving the highest ids into the
+ * holes, so ids stay dense. Record ids refer to the grid as of that
+ * record, i.e. added boxes get ids N, N+1, ... and can be changed by later
+ * records. Exits with an error message on malformed input, or if a
+ * changed or added box would overlap another box (found by the sweep, or
+ * by a row sharing more than its perimeter with its neighbors).
+ *
+ * @param input     {@code AMRInput} returned by {@code parseInput()}
+ * @param file_name path of the delta file
+ */
+void applyDelta(AMRInput* input, const char* file_name);
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "common.h"
+
+/**
+ * Environment variable enabling mixed-precision runs in {@code amr}
+ * (set to 1), unset or 0 for all-double runs
+ */
+#define MIXED_ENV "AMR_MIXED"
+
+/**
+ * Lower-precision DSVs (and weights) of the first phase of a mixed-precision run
+ */
+typedef float LowDSV;
+
+/**
+ * Extremal values of {@code LowDSV}s
+ */
+typedef struct LowMaxMin {
+    LowDSV max;
+    LowDSV min;
+} LowMaxMin;
+
+/**
+ * {@code UpdateKernel} (see {@code simd.h}) with {@code LowDSV}
+ * DSVs and weights, summing each box's terms in row order
+ */
+typedef LowMaxMin (*LowUpdateKernel)(const AMRInput* input, const LowDSV* diag_weights, const LowDSV* nhbr_weights,
+                                     Count start, Count end, const LowDSV* vals, LowDSV* updated_vals);
+
+/**
+ * The first phase ends before the iteration that would bring the
+ * convergence gap, (max - min) / max, within this many units of
+ * {@code LowDSV} resolution of epsilon, since the rounding of
+ * lower-precision DSVs could then decide convergence
+ */
+#define MIXED_GUARD 1024
+
+/**
+ * Reads whether {@code MIXED_ENV} enables mixed-precision runs
+ *
+ * @return 1 if enabled, 0 otherwise
+ */
+int mixedEnabled();
+
+/**
+ * Runs the lower-precision phase of a mixed-precision run: iterates with
+ * {@code LowDSV} copies of the DSVs and weights until the gap nears
+ * epsilon (see {@code MIXED_GUARD}), then writes the DSVs from before
+ * the iteration that got there back out in double to continue from.
+ *
+ * @param input        pointer to populated {@code AMRInput} struct
+ * @param kernel       lower-precision update kernel (see {@code lowUpdateKernel()})
+ * @param diag_weights {@code N} diagonal weights (see {@code computeWeightRange()})
+ * @param nhbr_weights {@code total_nhbrs} neighbor weights
+ * @param epsilon      convergence cutoff of the run
+ * @param max_min      extremal initial DSVs, set to those after the phase
+ * @param final_vals   room for {@code N} DSVs, set to the DSVs after the phase
+ * @return number of iterations run
+ */
+unsigned long runLowPrecision(const AMRInput* input, LowUpdateKernel kernel, const Weight* diag_weights,
+                              const Weight* nhbr_weights, float epsilon, AMRMaxMin* max_min,
+                              DSV* final_vals);
@@ -0,0 +1,116 @@
+#pragma once
+
+#include "amrb.h"
+#include "common.h"
+#include "reader.h"
+
+/**
+ * Environment variable enabling the out-of-core solver
+ * (any value other than empty or "0")
+ */
+#define OUT_OF_CORE_ENV "AMR_OUT_OF_CORE"
+
+/**
+ * Bytes of topology per window, the unit of read-ahead and release
+ */
+#define OUT_OF_CORE_WINDOW_BYTES (64 * 1024 * 1024)
+
+/**
+ * Range of boxes [{@code start}, {@code end}) streamed together,
+ * holding neighbors [{@code first_nhbr}, {@code last_nhbr})
+ */
+typedef struct GridWindow {
+    Count  start, end;
+    Offset first_nhbr, last_nhbr;
+} GridWindow;
+
+/**
+ * Compiled binary grid (see {@code amrb.h}) solved out of core.
+ *
+ * The CSR topology stays in the memory-mapped file and is streamed
+ * through window by window, in box order, every iteration: the next window
+ * is prefetched while the current one is solved, and each window is
+ * released again once it is done, so only about two windows of topology
+ * are mapped in at any time. Only the DSVs are held in memory.
+ *
+ * {@code source}        - mapped grid file
+ * {@code header}        - header at the start of {@code source}
+ * {@code N}             - number of boxes
+ * {@code windows}       - {@code num_windows} windows covering all boxes, in order
+ * {@code window_bytes}  - bytes of topology streamed per iteration
+ * {@code vals}          - private copy of the initial DSVs
+ * {@code parse_bytes}   - bytes read when opening the grid
+ * {@code parse_seconds} - wall-clock time spent in {@code openOutOfCoreGrid()}
+ */
+typedef struct OutOfCoreGrid {
+    InputBuffer*      source;
+    const AMRBHeader* header;
+    Count             N;
+
+    const Coord*  perimeters;
+    const Count*  num_nhbrs;
+    const Offset* offsets;
+    const Coord*  self_overlaps;
+    const Count*  nhbr_ids;
+    const Coord*  overlaps;
+
+    GridWindow* windows;
+    Count       num_windows;
+    size_t      window_bytes;
+
+    DSV* vals;
+
+    size_t parse_bytes;
+    double parse_seconds;
+} OutOfCoreGrid;
+
+/**
+ * Checks whether the out-of-core solver was requested
+ * through {@code OUT_OF_CORE_ENV}.
+ *
+ * @return non-zero if enabled
+ */
+int outOfCoreEnabled();
+
+/**
+ * Opens a compiled binary grid for out-of-core solving
+ * and splits it into windows of {@code OUT_OF_CORE_WINDOW_BYTES}.
+ * Exits with an error message if the file is not a compiled grid.
+ * Should be paired with {@code closeOutOfCoreGrid}.
+ *
+ * @param file_name path of the compiled grid
+ * @return the opened {@code OutOfCoreGrid}
+ */
+OutOfCoreGrid* openOutOfCoreGrid(const char* file_name);
+
+/**
+ * Starts reading a window's topology in the background.
+ *
+ * @param grid   opened {@code OutOfCoreGrid}
+ * @param window index of the window
+ */
+void prefetchWindow(OutOfCoreGrid* grid, Count window);
+
+/**
+ * Waits until a window's topology is in memory, by reading
+ * a byte of each of its pages, so solving it does not fault.
+ *
+ * @param grid   opened {@code OutOfCoreGrid}
+ * @param window index of the window
+ */
+void faultWindow(OutOfCoreGrid* grid, Count window);
+
+/**
+ * Drops a solved window's topology from this process' memory.
+ *
+ * @param grid   opened {@code OutOfCoreGrid}
+ * @param window index of the window
+ */
+void releaseWindow(OutOfCoreGrid* grid, Count window);
+
+/**
+ * Releases an {@code OutOfCoreGrid} created with {@code openOutOfCoreGrid}.
+ *
+ * @param grid pointer to {@code OutOfCoreGrid} returned by {@code openOutOfCoreGrid}
+ */
+void closeOutOfCoreGrid(OutOfCoreGrid* grid);
@@ -0,0 +1,94 @@
+#pragma once
+
+#include "common.h"
+
+/**
+ * Environment variable enabling the structured-patch update in {@code amr}
+ * (set to 1), unset or 0 for the CSR update
+ */
+#define PATCHES_ENV "AMR_PATCHES"
+
+/**
+ * Smallest patch side (in boxes) worth a stencil,
+ * i.e. patches have at least one interior box
+ */
+#define PATCH_MIN_SIDE 3
+
+/**
+ * Rectangle of equally sized boxes, each sharing a full side with
+ * the next box in its row and in its column, renumbered so box (r, c)
+ * of the patch has id {@code base + r * width + c}. Interior boxes
+ * (not in the first or last row or column) have exactly these four
+ * neighbors, with the same weights throughout the patch:
+ *
+ * {@code base}                   - id of the patch's top-left box
+ * {@code width}, {@code height}  - size in boxes
+ * {@code diag}                   - diagonal weight of an interior box
+ * {@code up}, {@code down}       - weights of the boxes above and below
+ * {@code left}, {@code right}    - weights of the boxes to the left and right
+ */
+typedef struct Patch {
+    Count  base;
+    Count  width, height;
+    Weight diag;
+    Weight up, down, left, right;
+} Patch;
+
+/**
+ * Patches of a grid plus the boxes left to the CSR update
+ * (patch borders and irregular boxes)
+ *
+ * {@code num_patches} - number of patches
+ * {@code patches}     - the patches
+ * {@code num_rows}    - number of boxes left to the CSR update
+ * {@code rows}        - those boxes, in id order
+ */
+typedef struct PatchSet {
+    Count  num_patches;
+    Patch* patches;
+    Count  num_rows;
+    Count* rows;
+} PatchSet;
+
+/**
+ * Reads whether {@code PATCHES_ENV} enables the structured-patch update
+ *
+ * @return 1 if enabled, 0 otherwise
+ */
+int patchesEnabled();
+
+/**
+ * Finds the patches of a grid, greedily from the top-left-most free box,
+ * and renumbers the grid (see {@code applyOrder()}) so each patch's boxes
+ * are contiguous, row by row, ahead of all other boxes.
+ * Patch weights are filled in by {@code setPatchWeights()}.
+ *
+ * @param input pointer to populated {@code AMRInput} struct, renumbered
+ * @return the patches, allocated from the input's arena
+ */
+PatchSet* buildPatches(AMRInput* input);
+
+/**
+ * Reads each patch's weights from the weights of one of its interior boxes
+ *
+ * @param patches      patches returned by {@code buildPatches()}
+ * @param input        pointer to the renumbered {@code AMRInput} struct
+ * @param diag_weights {@code N} diagonal weights (see {@code computeWeightRange()})
+ * @param nhbr_weights {@code total_nhbrs} neighbor weights
+ */
+void setPatchWeights(PatchSet* patches, const AMRInput* input,
+                     const Weight* diag_weights, const Weight* nhbr_weights);
+
+/**
+ * Computes one iteration's updated DSVs: patch interiors with a 5-point
+ * stencil on the DSVs directly, every other box through its CSR row
+ *
+ * @param patches      patches returned by {@code buildPatches()}
+ * @param input        pointer to the renumbered {@code AMRInput} struct
+ * @param diag_weights {@code N} diagonal weights
+ * @param nhbr_weights {@code total_nhbrs} neighbor weights
+ * @param vals         current DSVs
+ * @param updated_vals room for {@code N} DSVs
+ */
+void patchUpdate(const PatchSet* patches, const AMRInput* input, const Weight* diag_weights,
+                 const Weight* nhbr_weights, const DSV* vals, DSV* updated_vals);
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "common.h"
+
+/**
+ * Environment variable enabling the SELL-C-sigma update in {@code amr}:
+ * set to the sorting window sigma (in boxes, e.g. {@code 256}),
+ * unset or empty for the CSR update
+ */
+#define SELL_ENV "AMR_SELL"
+
+/**
+ * Rows per slice, updated in lockstep. Defaults to the number of DSVs
+ * in one SIMD register of the target (AVX-512: 8, AVX: 4, otherwise 2),
+ * can be set with {@code -DSELL_C=...}.
+ */
+#ifndef SELL_C
+#if defined(__AVX512F__)
+#define SELL_C 8
+#elif defined(__AVX__)
+#define SELL_C 4
+#else
+#define SELL_C 2
+#endif
+#endif
+
+/**
+ * Weighted topology in SELL-C-sigma (sliced ELLPACK) form.
+ *
+ * Within each window of {@code sigma} boxes the boxes are sorted by
+ * neighbor count (most first), then cut into slices of {@code SELL_C}
+ * rows. Each slice is padded to its longest row and stored column by
+ * column, so entry k of the slice's row r is at
+ * {@code slice_offsets[s] + k * SELL_C + r}. Padding entries point at
+ * the row's own box with weight 0, padding rows past {@code N} at box 0.
+ *
+ * {@code N}             - number of boxes
+ * {@code sigma}         - sorting window (a multiple of {@code SELL_C})
+ * {@code num_slices}    - ceil(N / SELL_C)
+ * {@code rows}          - box of each row, {@code num_slices * SELL_C} entries
+ * {@code widths}        - longest row of each slice
+ * {@code slice_offsets} - start of each slice's entries, {@code num_slices + 1} entries
+ * {@code diag_weights}  - diagonal weight of each row
+ * {@code nhbr_ids}      - neighbor of each entry
+ * {@code weights}       - weight of each entry
+ */
+typedef struct SellGrid {
+    Count   N;
+    Count   sigma;
+    Count   num_slices;
+    Count*  rows;
+    Count*  widths;
+    Offset* slice_offsets;
+    Weight* diag_weights;
+    Count*  nhbr_ids;
+    Weight* weights;
+} SellGrid;
+
+/**
+ * Reads the sorting window from {@code SELL_ENV}.
+ *
+ * @return the window, 0 if the CSR update is to be used
+ */
+Count sellSigma();
+
+/**
+ * Packs a grid and its weights (see {@code computeWeightRange()})
+ * into SELL-C-sigma form
+ *
+ * @param input        pointer to populated {@code AMRInput} struct
+ * @param sigma        sorting window, rounded up to a multiple of {@code SELL_C}
+ * @param diag_weights {@code N} diagonal weights
+ * @param nhbr_weights {@code total_nhbrs} neighbor weights
+ * @param arena        arena the grid is allocated from
+ * @return the packed grid
+ */
+SellGrid* buildSellGrid(const AMRInput* input, Count sigma, const Weight* diag_weights,
+                        const Weight* nhbr_weights, struct Arena* arena);
+
+/**
+ * Number of entries stored, padding included
+ */
+static inline Offset sellEntries(const SellGrid* sell) {
+    return sell->slice_offsets[sell->num_slices];
+}
+
+/**
+ * Computes one iteration's updated DSVs slice by slice,
+ * the {@code SELL_C} rows of a slice in lockstep
+ *
+ * @param sell         grid packed by {@code buildSellGrid()}
+ * @param vals         current DSVs, by box id
+ * @param updated_vals room for {@code N} DSVs, by box id
+ */
+void sellUpdate(const SellGrid* sell, const DSV* vals, DSV* updated_vals);
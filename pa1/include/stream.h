@@ -0,0 +1,107 @@
+#pragma once
+
+#include <stddef.h>
+#include <pthread.h>
+#include <sys/types.h>
+
+/**
+ * Size and number of the decompressed blocks in flight
+ * between the decompressing thread and the tokenizer
+ */
+#define STREAM_BLOCK_SIZE (1 << 20)
+#define STREAM_NUM_BLOCKS 4
+
+/**
+ * Room in front of every block for the partial token
+ * carried over from the previous block
+ */
+#define STREAM_HEADROOM 128
+
+typedef enum { COMPRESSION_NONE=0, COMPRESSION_GZIP, COMPRESSION_ZSTD } Compression;
+
+/**
+ * Compressed input, decompressed on a separate thread
+ * into a ring of {@code STREAM_NUM_BLOCKS} blocks.
+ *
+ * The tokenizer sees one window at a time. A window is a block cut back
+ * to its last whitespace, so tokens never straddle windows: the cut-off
+ * tail is copied into the headroom of the next block when moving on.
+ *
+ * {@code blocks}     - ring of blocks, each {@code STREAM_BLOCK_SIZE} bytes
+ *                      preceded by {@code STREAM_HEADROOM} bytes
+ * {@code sizes}      - number of decompressed bytes in each block
+ * {@code head}       - next filled block for the tokenizer
+ * {@code tail}       - next free block for the decompressor
+ * {@code num_filled} - blocks decompressed but not yet handed out
+ * {@code num_free}   - blocks the decompressor may fill
+ * {@code current}    - block holding the current window, -1 before the first
+ * {@code carry}      - cut-off tail of the current block
+ * {@code bytes}      - decompressed bytes handed out so far
+ * {@code eof}        - set by the decompressor after the last block
+ * {@code error}      - set by the decompressor if decompression failed
+ * {@code closed}     - set by the tokenizer to stop the decompressor early
+ */
+typedef struct InputStream {
+    Compression format;
+    int         fd;
+    void*       gz;
+    pid_t       child;
+    void*       zstd;
+
+    pthread_t       thread;
+    pthread_mutex_t lock;
+    pthread_cond_t  filled_cond;
+    pthread_cond_t  freed_cond;
+
+    char*  blocks[STREAM_NUM_BLOCKS];
+    size_t sizes[STREAM_NUM_BLOCKS];
+    int    head, tail;
+    int    num_filled, num_free;
+    int    current;
+
+    const char* carry;
+    size_t      carry_bytes;
+    size_t      bytes;
+
+    int eof, error, closed;
+} InputStream;
+
+/**
+ * Checks the magic bytes at the start of a file.
+ * Only regular files are checked, anything else
+ * (pipes, terminals) is reported as uncompressed.
+ *
+ * @param fd open file descriptor, its offset is not changed
+ * @return the {@code Compression} of the file
+ */
+Compression detectCompression(int fd);
+
+/**
+ * Starts decompressing the given file on a separate thread.
+ * The file descriptor is duplicated, so the caller may close it.
+ * Should be paired with {@code closeInputStream}.
+ *
+ * @param fd     open file descriptor, positioned at the start of the file
+ * @param format {@code Compression} of the file (not {@code COMPRESSION_NONE})
+ * @return the started {@code InputStream}
+ */
+InputStream* openInputStream(int fd, Compression format);
+
+/**
+ * Moves on to the next window, releasing the previous one.
+ * Waits for the decompressor if it has not caught up yet.
+ * Exits with an error message if decompression fails.
+ *
+ * @param stream {@code InputStream} to read from
+ * @param start  location to store the first byte of the window
+ * @param end    location to store one past the last byte of the window
+ * @return 1 if a window is available, 0 at the end of the input
+ */
+int nextStreamWindow(InputStream* stream, const char** start, const char** end);
+
+/**
+ * Stops the decompressor and releases an {@code InputStream}.
+ *
+ * @param stream pointer to {@code InputStream} returned by {@code openInputStream}
+ */
+void closeInputStream(InputStream* stream);
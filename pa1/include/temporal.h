@@ -0,0 +1,125 @@
+#pragma once
+
+#include "common.h"
+#include "simd.h"
+
+/**
+ * Environment variable enabling temporal blocking in {@code amr}: the number
+ * of iterations each block advances at a time (e.g. 4), unset or 0 for none
+ */
+#define TEMPORAL_ENV "AMR_TEMPORAL"
+
+/**
+ * Bytes of topology, weights and DSVs of a block, half for its own boxes
+ * and half for its ghost layers, so a block stays in a 2 MiB L2 cache
+ */
+#define TEMPORAL_BLOCK_BYTES (1 << 20)
+
+/**
+ * Most iterations per block: on a two-dimensional grid, about as deep as
+ * the ghost layers get before they outgrow the half of the block budget
+ * left to them
+ */
+#define TEMPORAL_MAX_STEPS 16
+
+/**
+ * Range of boxes advanced several iterations at a time, plus the boxes up to
+ * {@code steps} neighbor hops away (ghost layers) needed to do so without
+ * exchanging DSVs in between. Boxes are numbered locally by distance
+ * (own boxes first), and every box short of the outermost layer has its
+ * row copied with local neighbor ids:
+ *
+ * {@code num_local}  - number of boxes, own and ghost
+ * {@code layer_ends} - {@code layer_ends[d]} is the number of boxes at most
+ *                      {@code d} hops from an own box ({@code steps + 1} entries,
+ *                      {@code layer_ends[0]} own boxes)
+ * {@code ids}        - global id of each box
+ * {@code offsets}, {@code num_nhbrs}, {@code nhbr_ids} - local CSR rows
+ *                      (first {@code layer_ends[steps - 1]} boxes)
+ * {@code diag_weights}, {@code nhbr_weights}          - their weights
+ */
+typedef struct TemporalBlock {
+    Count   num_local;
+    Count*  layer_ends;
+    Count*  ids;
+    Offset* offsets;
+    Count*  num_nhbrs;
+    Count*  nhbr_ids;
+    Weight* diag_weights;
+    Weight* nhbr_weights;
+} TemporalBlock;
+
+/**
+ * Grid split into blocks:
+ *
+ * {@code steps}      - iterations each block advances at a time
+ * {@code num_blocks} - number of blocks
+ * {@code blocks}     - the blocks, covering the grid's boxes in id order
+ * {@code vals}, {@code updated_vals} - scratch DSVs for the largest block
+ * {@code num_ghosts} - ghost boxes over all blocks (the redundant work)
+ */
+typedef struct TemporalGrid {
+    Count          steps;
+    Count          num_blocks;
+    TemporalBlock* blocks;
+    DSV*           vals;
+    DSV*           updated_vals;
+    Offset         num_ghosts;
+} TemporalGrid;
+
+/**
+ * Reads the iterations per block from {@code TEMPORAL_ENV}.
+ * Exits with an error message on anything but a number
+ * up to {@code TEMPORAL_MAX_STEPS}.
+ *
+ * @return the iterations per block, 0 if temporal blocking is disabled
+ */
+Count temporalSteps();
+
+/**
+ * Splits a grid into blocks of consecutive ids (see {@code TEMPORAL_BLOCK_BYTES})
+ * and finds each block's ghost layers, copying the weights of their rows
+ *
+ * @param input        pointer to populated {@code AMRInput} struct
+ * @param steps        iterations each block advances at a time
+ * @param diag_weights {@code N} diagonal weights (see {@code computeWeightRange()})
+ * @param nhbr_weights {@code total_nhbrs} neighbor weights
+ * @param arena        arena the blocks are allocated from
+ * @return the blocked grid
+ */
+TemporalGrid* buildTemporalGrid(const AMRInput* input, Count steps, const Weight* diag_weights,
+                                const Weight* nhbr_weights, struct Arena* arena);
+
+/**
+ * Advances every block {@code steps} iterations, giving the same DSVs as
+ * that many single iterations (each box's terms are summed in row order)
+ *
+ * @param grid         grid built by {@code buildTemporalGrid()}
+ * @param vals         current DSVs
+ * @param updated_vals room for {@code N} DSVs, set to the DSVs {@code steps} iterations on
+ * @return maximum and minimum DSV of {@code updated_vals}
+ */
+AMRMaxMin temporalSweep(const TemporalGrid* grid, const DSV* vals, DSV* updated_vals);
+
+/**
+ * Iterates until convergence, testing only after every {@code steps} iterations.
+ * Once a sweep ends converged, the DSVs before it are replayed one iteration
+ * at a time with {@code kernel} to find the exact iteration that converged.
+ * This relies on the gap never growing, which holds for affect rates from
+ * 0 to 1 (the weights of each box are then a convex combination), the
+ * only ones {@code run()} blocks.
+ *
+ * @param grid         grid built by {@code buildTemporalGrid()}
+ * @param input        pointer to populated {@code AMRInput} struct, whose
+ *                     {@code vals} are swapped with {@code *updated_vals} as in {@code run()}
+ * @param kernel       single-iteration update of the replay
+ * @param diag_weights {@code N} diagonal weights
+ * @param nhbr_weights {@code total_nhbrs} neighbor weights
+ * @param epsilon      convergence cutoff
+ * @param max_min      extremal DSVs of {@code input->vals}, updated to those at convergence
+ * @param updated_vals room for {@code N} DSVs
+ * @return number of iterations run
+ */
+unsigned long runTemporal(const TemporalGrid* grid, AMRInput* input, UpdateKernel kernel,
+                          const Weight* diag_weights, const Weight* nhbr_weights,
+                          float epsilon, AMRMaxMin* max_min, DSV** updated_vals);
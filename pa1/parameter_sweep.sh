@@ -44,13 +44,16 @@ cp ${PBS_O_WORKDIR}/* . -rp
 
 make clean && make
 
-# Run tests
+# Run tests (parsed grids are cached across runs and jobs)
 mkdir -p ${PBS_O_WORKDIR}/results
+export AMR_CACHE_DIR=${PBS_O_WORKDIR}/.amr-cache
+export AMR_SHARED_TOPOLOGY=1
 
 source tests.cfg
 for test_file in ${test_files[@]}; do
   run_tests ${test_file}
 done
+rm -f /dev/shm/amr-*
 
 # Process results
 for test_file in ${test_files[@]}; do
@@ -0,0 +1,145 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "adjacency.h"
+
+/**
+ * Orders edges by line, then edges ending before starting ones,
+ * then along the line
+ */
+static int compareEdges(const void* a, const void* b) {
+    const BoxEdge* edge_a = (const BoxEdge*) a;
+    const BoxEdge* edge_b = (const BoxEdge*) b;
+    if (edge_a->line != edge_b->line) {
+        return (edge_a->line < edge_b->line) ? -1 : 1;
+    }
+    if (edge_a->starts != edge_b->starts) {
+        return edge_a->starts - edge_b->starts;
+    }
+    if (edge_a->lo != edge_b->lo) {
+        return (edge_a->lo < edge_b->lo) ? -1 : 1;
+    }
+    return 0;
+}
+
+/**
+ * Sorts edges and pairs up overlapping ending/starting edges on each line.
+ * Edges of one kind on a line are disjoint, so a merge-like walk finds all
+ * pairs with at most (ending + starting - 1) pairs per line.
+ *
+ * @param pairs room for {@code num_edges} pairs, stored as
+ *              (box before the line, box after the line)
+ * @return number of pairs found
+ */
+static Count sweepEdges(BoxEdge* edges, Count num_edges, Count* pairs) {
+    qsort(edges, num_edges, sizeof(*edges), &compareEdges);
+
+    Count num_pairs = 0;
+    Count i         = 0;
+    while (i < num_edges) {
+        Coord line = edges[i].line;
+        Count ends = i;
+        while ((i < num_edges) && (edges[i].line == line) && !edges[i].starts) {
+            ++i;
+        }
+        Count ends_end = i;
+        Count starts   = i;
+        while ((i < num_edges) && (edges[i].line == line)) {
+            ++i;
+        }
+        Count starts_end = i;
+
+        while ((ends < ends_end) && (starts < starts_end)) {
+            BoxEdge* before = &edges[ends];
+            BoxEdge* after  = &edges[starts];
+            Coord    lo     = (before->lo > after->lo) ? before->lo : after->lo;
+            Coord    hi     = (before->hi < after->hi) ? before->hi : after->hi;
+            if (lo < hi) {
+                pairs[2 * num_pairs]     = before->id;
+                pairs[2 * num_pairs + 1] = after->id;
+                ++num_pairs;
+            }
+            if (before->hi < after->hi) {
+                ++ends;
+            } else {
+                ++starts;
+            }
+        }
+    }
+    return num_pairs;
+}
+
+/**
+ * {@inheritDoc}
+ */
+void buildAdjacency(GridRecords* records, Arena* arena, Arena* scratch) {
+    Count      N      = records->N;
+    BoxBounds* bounds = records->bounds;
+
+    BoxEdge* edges       = arenaAlloc(scratch, 2 * N * sizeof(*edges));
+    Count*   horiz_pairs = arenaAlloc(scratch, 2 * 2 * N * sizeof(*horiz_pairs));
+    Count*   vert_pairs  = arenaAlloc(scratch, 2 * 2 * N * sizeof(*vert_pairs));
+
+    /**
+     * Horizontal edges: box above the line is TOP of the box below it
+     */
+    for (Count i = 0; i < N; ++i) {
+        edges[2 * i]     = (BoxEdge) { bounds[i].y_max, bounds[i].x_min, bounds[i].x_max, i, 0 };
+        edges[2 * i + 1] = (BoxEdge) { bounds[i].y_min, bounds[i].x_min, bounds[i].x_max, i, 1 };
+    }
+    Count num_horiz = sweepEdges(edges, 2 * N, horiz_pairs);
+
+    /**
+     * Vertical edges: box left of the line is LEFT of the box right of it
+     */
+    for (Count i = 0; i < N; ++i) {
+        edges[2 * i]     = (BoxEdge) { bounds[i].x_max, bounds[i].y_min, bounds[i].y_max, i, 0 };
+        edges[2 * i + 1] = (BoxEdge) { bounds[i].x_min, bounds[i].y_min, bounds[i].y_max, i, 1 };
+    }
+    Count num_vert = sweepEdges(edges, 2 * N, vert_pairs);
+
+    /**
+     * Count neighbors per direction, then lay out the CSR arrays
+     */
+    Count* dir_nhbrs = records->dir_nhbrs;
+    memset(dir_nhbrs, 0, NUM_DIR * N * sizeof(*dir_nhbrs));
+    for (Count p = 0; p < num_horiz; ++p) {
+        ++dir_nhbrs[NUM_DIR * horiz_pairs[2 * p + 1] + TOP];
+        ++dir_nhbrs[NUM_DIR * horiz_pairs[2 * p] + BOTTOM];
+    }
+    for (Count p = 0; p < num_vert; ++p) {
+        ++dir_nhbrs[NUM_DIR * vert_pairs[2 * p + 1] + LEFT];
+        ++dir_nhbrs[NUM_DIR * vert_pairs[2 * p] + RIGHT];
+    }
+
+    Offset* next = arenaAlloc(scratch, NUM_DIR * N * sizeof(*next));
+    records->offsets[0] = 0;
+    for (Count i = 0; i < N; ++i) {
+        Offset offset = records->offsets[i];
+        for (DIRECTION dir = TOP; dir <= RIGHT; ++dir) {
+            next[NUM_DIR * i + dir] = offset;
+            offset += dir_nhbrs[NUM_DIR * i + dir];
+        }
+        records->offsets[i + 1] = offset;
+    }
+
+    /**
+     * Pairs come out line by line, in order along each line,
+     * so every direction's neighbors end up in edge order
+     */
+    Count* nhbr_ids = arenaAlloc(arena, records->offsets[N] * sizeof(*nhbr_ids));
+    for (Count p = 0; p < num_horiz; ++p) {
+        Count above = horiz_pairs[2 * p];
+        Count below = horiz_pairs[2 * p + 1];
+        nhbr_ids[next[NUM_DIR * below + TOP]++]    = above;
+        nhbr_ids[next[NUM_DIR * above + BOTTOM]++] = below;
+    }
+    for (Count p = 0; p < num_vert; ++p) {
+        Count left  = vert_pairs[2 * p];
+        Count right = vert_pairs[2 * p + 1];
+        nhbr_ids[next[NUM_DIR * right + LEFT]++] = left;
+        nhbr_ids[next[NUM_DIR * left + RIGHT]++] = right;
+    }
+    records->nhbr_ids = nhbr_ids;
+}
@@ -1,31 +1,61 @@
+#include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 
 #include "amr.h"
+#include "arena.h"
+#include "color.h"
 #include "common.h"
+#include "compact.h"
+#include "ingest.h"
+#include "mixed.h"
+#include "outofcore.h"
+#include "patch.h"
+#include "reorder.h"
+#include "sell.h"
+#include "simd.h"
+#include "temporal.h"
 
 const char* usage = "\
-Usage: amr [affect-rate] [epsilon]\n\
+Usage: amr [affect-rate] [epsilon] [test-file | --stdin]\n\
 \n\
 affect-rate: float value controlling the effect of neighboring boxes\n\
-epislon    : float value determining the cutoff for convergence\n";
+epislon    : float value determining the cutoff for convergence\n\
+test-file  : test file with input to AMR problem, memory-mapped\n\
+--stdin    : read input from stdin instead (the default when omitted)\n\
+\n\
+With AMR_OUT_OF_CORE=1, test-file must be a compiled grid (see amr-compile),\n\
+which is streamed from disk every iteration instead of loaded into memory\n";
 
 int main(int argc, char** argv) {
     /**
      * Parse command-line arguments
      */
-    if (argc != 3) {
+    if ((argc != 3) && (argc != 4)) {
         printf("%s", usage);
         exit(1);
     }
     float affect_rate = strtof(argv[1], NULL);
     float epsilon     = strtof(argv[2], NULL);
 
+    const char* test_file = NULL;
+    if ((argc == 4) && (strcmp(argv[3], "--stdin") != 0)) {
+        test_file = argv[3];
+    }
+
     /**
-     * Parse input data from standard input
+     * Parse input data from test file (or standard input),
+     * or only open it when solving out of core
      */
-    AMRInput* input = parseInput();
+    AMRInput*      input = NULL;
+    OutOfCoreGrid* grid  = NULL;
+    if (outOfCoreEnabled()) {
+        grid = openOutOfCoreGrid(test_file);
+    } else {
+        input = parseInput(test_file, parseThreads());
+    }
 
     /**
      * Run and collect timing information
@@ -36,7 +66,9 @@ int main(int argc, char** argv) {
     struct timespec gettime_before;
     clock_gettime(CLOCK_REALTIME, &gettime_before);
 
-    AMROutput output = run(input, affect_rate, epsilon);
+    AMROutput output = (grid != NULL)
+        ? runOutOfCore(grid, affect_rate, epsilon)
+        : run(input, affect_rate, epsilon);
 
     time_t time_after;
     time(&time_after);
@@ -59,7 +91,11 @@ int main(int argc, char** argv) {
     /**
      * Clean up
      */
-    destroyInput(input);
+    if (grid != NULL) {
+        closeOutOfCoreGrid(grid);
+    } else {
+        destroyInput(input);
+    }
     return 0;
 }
 
@@ -67,40 +103,175 @@ int main(int argc, char** argv) {
  * {@inheritDoc}
  */
 AMROutput run(AMRInput* input, float affect_rate, float epsilon) {
+    /**
+     * Renumber regular patches of the grid into dense rectangles
+     * if the structured-patch update is enabled
+     */
+    PatchSet* patches = NULL;
+    if (patchesEnabled()) {
+        patches = buildPatches(input);
+    }
+
+    /**
+     * Or renumber it by color class if the Gauss-Seidel update is
+     * enabled, which updates a single buffer of DSVs in place.
+     * Convergence is still tested every iteration (deferred checks,
+     * AMR_DEFERRED, only exist in the pa2, pa3 and pa5 solvers).
+     */
+    ColorClasses* colors = NULL;
+    if (gaussSeidelEnabled()) {
+        if (patchesEnabled() || (sellSigma() > 0) || compactEnabled() || (temporalSteps() > 0) || mixedEnabled()) {
+            fprintf(stderr, "Error: %s only combines with the CSR update\n", GAUSS_SEIDEL_ENV);
+            exit(1);
+        }
+        colors = colorBoxes(input);
+    }
+
     /**
      * Repeat until convergence
      */
     AMRMaxMin max_min = getMaxMin(input);
-    DSV* updated_vals = malloc(input->N * sizeof(*updated_vals));
+    DSV* updated_vals = NULL;
+    if (colors == NULL) {
+        updated_vals = arenaAlloc(input->arena, input->N * sizeof(*updated_vals));
+    }
+
+    /**
+     * Fold the coefficients that stay constant for the run into weights
+     */
+    Weight* diag_weights = arenaAlloc(input->arena, input->N * sizeof(*diag_weights));
+    Weight* nhbr_weights = arenaAlloc(input->arena, input->total_nhbrs * sizeof(*nhbr_weights));
+    computeWeightRange(input, affect_rate, 0, input->N, diag_weights, nhbr_weights);
+    if (patches != NULL) {
+        setPatchWeights(patches, input, diag_weights, nhbr_weights);
+    }
+
+    /**
+     * Pack the weighted topology into slices if the
+     * SELL-C-sigma update is enabled
+     */
+    SellGrid* sell  = NULL;
+    Count     sigma = sellSigma();
+    if (sigma > 0) {
+        if (patches != NULL) {
+            fprintf(stderr, "Error: %s and %s cannot be combined\n", PATCHES_ENV, SELL_ENV);
+            exit(1);
+        }
+        sell = buildSellGrid(input, sigma, diag_weights, nhbr_weights, input->arena);
+    }
+
+    /**
+     * Or narrow the neighbor ids and overlaps if the compact update
+     * is enabled (grids with overlaps past 16 bits stay CSR)
+     */
+    CompactGrid* compact = NULL;
+    if (compactEnabled()) {
+        if (sell != NULL) {
+            fprintf(stderr, "Error: %s and %s cannot be combined\n", SELL_ENV, COMPACT_ENV);
+            exit(1);
+        }
+        if (patches != NULL) {
+            fprintf(stderr, "Error: %s and %s cannot be combined\n", PATCHES_ENV, COMPACT_ENV);
+            exit(1);
+        }
+        compact = buildCompactGrid(input, affect_rate, diag_weights, input->arena);
+    }
+
+    /**
+     * Otherwise the CSR update runs the widest kernel the CPU supports
+     */
+    UpdateKernel kernel = updateKernel(simdKind());
+
+    /**
+     * Split the grid into cache-sized blocks (with ghost layers)
+     * if temporal blocking is enabled
+     */
+    TemporalGrid* temporal = NULL;
+    Count         steps    = temporalSteps();
+    if (steps > 0) {
+        if ((sell != NULL) || (compact != NULL) || (patches != NULL)) {
+            fprintf(stderr, "Error: %s only combines with the CSR update\n", TEMPORAL_ENV);
+            exit(1);
+        }
+        if (!((affect_rate >= 0) && (affect_rate <= 1))) {
+            fprintf(stderr, "Error: %s needs an affect rate from 0 to 1\n", TEMPORAL_ENV);
+            exit(1);
+        }
+        temporal = buildTemporalGrid(input, steps, diag_weights, nhbr_weights, input->arena);
+    }
 
     /**
      * updated_vals and input->vals are swapped during
-     * execution, need to remember originals for clean up
+     * execution, need to remember the original DSVs
      */
-    DSV* orig_vals         = input->vals;
-    DSV* orig_updated_vals = updated_vals;
+    DSV* orig_vals = input->vals;
 
-    unsigned long iter;
-    for (iter = 0; (max_min.max - max_min.min) / max_min.max > epsilon; ++iter, max_min = getMaxMin(input)) {
+    /**
+     * DSVs are printed by the ids the boxes were loaded
+     * with, even if the grid was renumbered
+     */
+    #if (PRINT_DSVS != 0)
+    DSV* print_vals = arenaAlloc(input->arena, input->N * sizeof(*print_vals));
+    #endif
+
+    /**
+     * Mixed-precision runs take the first iterations with float DSVs,
+     * continuing in double from where they stop
+     */
+    unsigned long low_iterations = 0;
+    if (mixedEnabled()) {
+        low_iterations = runLowPrecision(input, lowUpdateKernel(simdKind()), diag_weights, nhbr_weights,
+                                         epsilon, &max_min, updated_vals);
+        DSV* temp = input->vals;
+        input->vals = updated_vals;
+        updated_vals = temp;
+    }
+
+    /**
+     * Temporally blocked runs iterate to convergence in blocks,
+     * leaving nothing for the loop below
+     */
+    unsigned long iter = low_iterations;
+    if (temporal != NULL) {
+        iter += runTemporal(temporal, input, kernel, diag_weights, nhbr_weights, epsilon, &max_min, &updated_vals);
+    }
+
+    for (; (max_min.max - max_min.min) / max_min.max > epsilon; ++iter) {
         #if (PRINT_DSVS != 0)
         printf("BEGIN ITERATION %lu\n", iter + 1);
-        printDSVs(input->N, input->vals);
+        restoreOrder(input, input->vals, print_vals);
+        printDSVs(input->N, print_vals);
         #endif
         /**
-         * For each box
+         * Gauss-Seidel: for each color class, in place (the class
+         * only reads DSVs of other classes, updated or not)
          */
-        for (int i = 0; i < input->N; ++i) {
-            BoxData* box = &input->boxes[i];
-            /**
-             * Compute updated DSV
-             */
-            updated_vals[i] = box->self_overlap * input->vals[i];
-            for (int nhbr = 0; nhbr < box->num_nhbrs; ++nhbr) {
-                updated_vals[i] += box->overlaps[nhbr] * input->vals[box->nhbr_ids[nhbr]];
+        if (colors != NULL) {
+            max_min = (AMRMaxMin) { -HUGE_VAL, HUGE_VAL };
+            for (Count c = 0; c < colors->num_colors; ++c) {
+                AMRMaxMin range = kernel(input, diag_weights, nhbr_weights, colors->starts[c],
+                                         colors->starts[c + 1], input->vals, input->vals);
+                max_min.max = (range.max > max_min.max) ? range.max : max_min.max;
+                max_min.min = (range.min < max_min.min) ? range.min : max_min.min;
             }
-            updated_vals[i] /= box->perimeter;
-            updated_vals[i] = input->vals[i] * (1 - affect_rate)
-                + updated_vals[i] * affect_rate;
+            continue;
+        }
+
+        /**
+         * For each box (or slice of boxes); the CSR kernels track the
+         * extremal DSVs as they go, the other updates take a second pass
+         */
+        if (sell != NULL) {
+            sellUpdate(sell, input->vals, updated_vals);
+            max_min = getDSVMaxMin(input->N, updated_vals);
+        } else if (compact != NULL) {
+            compactUpdate(input, compact, input->vals, updated_vals);
+            max_min = getDSVMaxMin(input->N, updated_vals);
+        } else if (patches != NULL) {
+            patchUpdate(patches, input, diag_weights, nhbr_weights, input->vals, updated_vals);
+            max_min = getDSVMaxMin(input->N, updated_vals);
+        } else {
+            max_min = kernel(input, diag_weights, nhbr_weights, 0, input->N, input->vals, updated_vals);
         }
 
         /**
@@ -112,13 +283,105 @@ AMROutput run(AMRInput* input, float affect_rate, float epsilon) {
     }
 
     input->vals = orig_vals;
+
+    AMROutput result = { 0 };
+    result.affect_rate = affect_rate;
+    result.epsilon     = epsilon;
+    result.iterations  = iter;
+    result.max         = max_min.max;
+    result.min         = max_min.min;
+    result.low_iterations = low_iterations;
+    result.parse_bytes   = input->parse_bytes;
+    result.parse_seconds   = input->parse_seconds;
+    result.overlap_seconds = input->overlap_seconds;
+    return result;
+}
+
+/**
+ * {@inheritDoc}
+ */
+AMROutput runOutOfCore(OutOfCoreGrid* grid, float affect_rate, float epsilon) {
+    AMRMaxMin max_min = getDSVMaxMin(grid->N, grid->vals);
+    DSV* vals         = grid->vals;
+    DSV* updated_vals = malloc(grid->N * sizeof(*updated_vals));
+
+    /**
+     * updated_vals and vals are swapped during
+     * execution, need to remember originals for clean up
+     */
+    DSV* orig_updated_vals = updated_vals;
+
+    AMROutput result = { 0 };
+
+    /**
+     * Repeat until convergence
+     */
+    unsigned long iter;
+    for (iter = 0; (max_min.max - max_min.min) / max_min.max > epsilon; ++iter, max_min = getDSVMaxMin(grid->N, vals)) {
+        #if (PRINT_DSVS != 0)
+        printf("BEGIN ITERATION %lu\n", iter + 1);
+        printDSVs(grid->N, vals);
+        #endif
+        /**
+         * Stream the topology window by window, reading the next window
+         * ahead while this one is solved. Only the time spent advising
+         * and waiting for windows counts as I/O, not solving them.
+         */
+        struct timespec io_before;
+        clock_gettime(CLOCK_REALTIME, &io_before);
+        prefetchWindow(grid, 0);
+        double io_seconds = secondsSince(io_before);
+        for (Count window = 0; window < grid->num_windows; ++window) {
+            clock_gettime(CLOCK_REALTIME, &io_before);
+            if (window + 1 < grid->num_windows) {
+                prefetchWindow(grid, window + 1);
+            }
+            faultWindow(grid, window);
+            io_seconds += secondsSince(io_before);
+
+            for (Count i = grid->windows[window].start; i < grid->windows[window].end; ++i) {
+                const Count* nhbr_ids = &grid->nhbr_ids[grid->offsets[i]];
+                const Coord* overlaps = &grid->overlaps[grid->offsets[i]];
+
+                /**
+                 * Compute updated DSV
+                 */
+                DSV updated = grid->self_overlaps[i] * vals[i];
+                for (Count nhbr = 0; nhbr < grid->num_nhbrs[i]; ++nhbr) {
+                    updated += overlaps[nhbr] * vals[nhbr_ids[nhbr]];
+                }
+                updated /= grid->perimeters[i];
+                updated_vals[i] = vals[i] * (1 - affect_rate)
+                    + updated * affect_rate;
+            }
+
+            clock_gettime(CLOCK_REALTIME, &io_before);
+            releaseWindow(grid, window);
+            io_seconds += secondsSince(io_before);
+        }
+
+        result.io_bytes   += grid->window_bytes;
+        result.io_seconds += io_seconds;
+        if (io_seconds > result.io_worst_seconds) {
+            result.io_worst_seconds = io_seconds;
+        }
+
+        /**
+         * Commit updated DSVs
+         */
+        DSV* temp = vals;
+        vals = updated_vals;
+        updated_vals = temp;
+    }
+
     free(orig_updated_vals);
 
-    AMROutput result;
     result.affect_rate = affect_rate;
     result.epsilon     = epsilon;
     result.iterations  = iter;
     result.max         = max_min.max;
     result.min         = max_min.min;
+    result.parse_bytes   = grid->parse_bytes;
+    result.parse_seconds = grid->parse_seconds;
     return result;
 }
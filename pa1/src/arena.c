@@ -0,0 +1,183 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "arena.h"
+
+/**
+ * Rounds {@code bytes} up to the next multiple of {@code ARENA_ALIGNMENT}
+ */
+static inline size_t alignArena(size_t bytes) {
+    return (bytes + ARENA_ALIGNMENT - 1) & ~((size_t) ARENA_ALIGNMENT - 1);
+}
+
+/**
+ * {@inheritDoc}
+ */
+HugePageMode hugePageMode() {
+    const char* mode = getenv(HUGE_PAGES_ENV);
+    if ((mode == NULL) || (*mode == '\0') || (strcmp(mode, "0") == 0)) {
+        return HUGE_PAGES_OFF;
+    }
+    if ((strcmp(mode, "thp") == 0) || (strcmp(mode, "1") == 0)) {
+        return HUGE_PAGES_THP;
+    }
+    if (strcmp(mode, "hugetlb") == 0) {
+        return HUGE_PAGES_HUGETLB;
+    }
+    fprintf(stderr, "Error: unknown %s '%s' (expected thp, hugetlb or 0)\n", HUGE_PAGES_ENV, mode);
+    exit(1);
+}
+
+/**
+ * Maps {@code size} bytes (a multiple of {@code HUGE_PAGE_SIZE}) starting on a
+ * {@code HUGE_PAGE_SIZE} boundary and advises them for transparent huge pages,
+ * by over-mapping and unmapping the unaligned head and tail
+ *
+ * @return the mapping, or {@code MAP_FAILED}
+ */
+static void* mapAligned(size_t size) {
+    char* mapped = mmap(NULL, size + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (mapped == MAP_FAILED) {
+        return MAP_FAILED;
+    }
+    size_t head = (HUGE_PAGE_SIZE - ((size_t) mapped & (HUGE_PAGE_SIZE - 1))) & (HUGE_PAGE_SIZE - 1);
+    if (head > 0) {
+        munmap(mapped, head);
+    }
+    munmap(mapped + head + size, HUGE_PAGE_SIZE - head);
+    #ifdef MADV_HUGEPAGE
+    madvise(mapped + head, size, MADV_HUGEPAGE);
+    #endif
+    return mapped + head;
+}
+
+/**
+ * Maps a new block of at least {@code size} bytes,
+ * backed by the pages {@code hugePageMode()} asks for
+ */
+static ArenaBlock* mapBlock(size_t size) {
+    HugePageMode mode  = hugePageMode();
+    ArenaBlock*  block = MAP_FAILED;
+    if (mode != HUGE_PAGES_OFF) {
+        size = (size + HUGE_PAGE_SIZE - 1) & ~((size_t) HUGE_PAGE_SIZE - 1);
+    }
+    /**
+     * Huge page pool mappings are reserved up front (no MAP_NORESERVE),
+     * so a pool too small for the block fails here instead of on first touch
+     */
+    #ifdef MAP_HUGETLB
+    if (mode == HUGE_PAGES_HUGETLB) {
+        block = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    }
+    #endif
+    if ((block == MAP_FAILED) && (mode != HUGE_PAGES_OFF)) {
+        block = mapAligned(size);
+    }
+    if (block == MAP_FAILED) {
+        block = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    }
+    if (block == MAP_FAILED) {
+        perror("mmap");
+        exit(1);
+    }
+    block->next = NULL;
+    block->size = size;
+    block->used = alignArena(sizeof(*block));
+    return block;
+}
+
+/**
+ * {@inheritDoc}
+ */
+Arena* createArena(size_t block_size) {
+    ArenaBlock* block = mapBlock(block_size);
+    Arena*      arena = (Arena*) ((char*) block + block->used);
+    block->used      += alignArena(sizeof(*arena));
+    arena->head       = block;
+    arena->block_size = block_size;
+    arena->last       = NULL;
+    return arena;
+}
+
+/**
+ * {@inheritDoc}
+ */
+void* arenaAlloc(Arena* arena, size_t bytes) {
+    ArenaBlock* block = arena->head;
+    bytes = alignArena(bytes);
+    if (block->used + bytes > block->size) {
+        size_t size = alignArena(sizeof(*block)) + bytes;
+        if (size < arena->block_size) {
+            size = arena->block_size;
+        }
+        block       = mapBlock(size);
+        block->next = arena->head;
+        arena->head = block;
+    }
+    void* ptr    = (char*) block + block->used;
+    block->used += bytes;
+    arena->last  = ptr;
+    return ptr;
+}
+
+/**
+ * {@inheritDoc}
+ */
+void arenaTrim(Arena* arena, void* ptr, size_t bytes) {
+    if (ptr != arena->last) {
+        return;
+    }
+    ArenaBlock* block  = arena->head;
+    size_t      offset = (char*) ptr - (char*) block;
+    if (offset + alignArena(bytes) <= block->used) {
+        block->used = offset + alignArena(bytes);
+    }
+}
+
+/**
+ * {@inheritDoc}
+ */
+void* arenaGrow(Arena* arena, void* ptr, size_t used, size_t bytes) {
+    ArenaBlock* block = arena->head;
+    if (ptr == arena->last) {
+        size_t offset = (char*) ptr - (char*) block;
+        if (offset + alignArena(bytes) <= block->size) {
+            block->used = offset + alignArena(bytes);
+            return ptr;
+        }
+        block->used = offset;
+    }
+
+    /**
+     * Reserve as much again to grow into, then hand back the
+     * old allocation's pages (the ones it does not share)
+     */
+    char* grown = arenaAlloc(arena, 2 * bytes);
+    arenaTrim(arena, grown, bytes);
+    memcpy(grown, ptr, used);
+    size_t page  = sysconf(_SC_PAGESIZE);
+    size_t start = ((size_t) ptr + page - 1) & ~(page - 1);
+    size_t end   = ((size_t) ptr + used) & ~(page - 1);
+    if (start < end) {
+        madvise((void*) start, end - start, MADV_DONTNEED);
+    }
+    return grown;
+}
+
+/**
+ * {@inheritDoc}
+ */
+void destroyArena(Arena* arena) {
+    ArenaBlock* block = arena->head;
+    while (block != NULL) {
+        ArenaBlock* next = block->next;
+        munmap(block, block->size);
+        block = next;
+    }
+}
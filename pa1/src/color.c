@@ -0,0 +1,114 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+#include "color.h"
+#include "reorder.h"
+
+/**
+ * {@inheritDoc}
+ */
+int gaussSeidelEnabled() {
+    const char* enabled = getenv(GAUSS_SEIDEL_ENV);
+    return (enabled != NULL) && (*enabled != '\0') && (strcmp(enabled, "0") != 0);
+}
+
+/**
+ * {@inheritDoc}
+ */
+ColorClasses* colorBoxes(AMRInput* input) {
+    Count N = input->N;
+
+    /**
+     * The earlier boxes listing each box as a neighbor (those of box i are
+     * {@code readers_of[reader_starts[i]]} to {@code readers_of[reader_starts[i + 1]]},
+     * exclusive), so a box also avoids the colors of the boxes that read it
+     * when neighbor lists are not symmetric
+     */
+    Offset* reader_starts = malloc((N + 1) * sizeof(*reader_starts));
+    memset(reader_starts, 0, (N + 1) * sizeof(*reader_starts));
+    for (Count i = 0; i < N; ++i) {
+        const Count* nhbr_ids = &input->nhbr_ids[input->offsets[i]];
+        for (Count nhbr = 0; nhbr < input->num_nhbrs[i]; ++nhbr) {
+            if (nhbr_ids[nhbr] > i) {
+                ++reader_starts[nhbr_ids[nhbr] + 1];
+            }
+        }
+    }
+    for (Count i = 0; i < N; ++i) {
+        reader_starts[i + 1] += reader_starts[i];
+    }
+    Count*  readers_of  = malloc(reader_starts[N] * sizeof(*readers_of));
+    Offset* next_reader = malloc(N * sizeof(*next_reader));
+    memcpy(next_reader, reader_starts, N * sizeof(*next_reader));
+    for (Count i = 0; i < N; ++i) {
+        const Count* nhbr_ids = &input->nhbr_ids[input->offsets[i]];
+        for (Count nhbr = 0; nhbr < input->num_nhbrs[i]; ++nhbr) {
+            if (nhbr_ids[nhbr] > i) {
+                readers_of[next_reader[nhbr_ids[nhbr]]++] = i;
+            }
+        }
+    }
+    free(next_reader);
+
+    /**
+     * A box has at most one color more than the earlier boxes it reads or
+     * is read by; {@code taken_by[c]} is the last box that saw one of color c
+     */
+    Count max_degree = 0;
+    for (Count i = 0; i < N; ++i) {
+        Count degree = input->num_nhbrs[i] + (Count) (reader_starts[i + 1] - reader_starts[i]);
+        max_degree   = (degree > max_degree) ? degree : max_degree;
+    }
+    Count* colors   = malloc(N * sizeof(*colors));
+    Count* taken_by = malloc((max_degree + 1) * sizeof(*taken_by));
+    memset(taken_by, 0xFF, (max_degree + 1) * sizeof(*taken_by));
+
+    Count num_colors = 0;
+    for (Count i = 0; i < N; ++i) {
+        const Count* nhbr_ids = &input->nhbr_ids[input->offsets[i]];
+        for (Count nhbr = 0; nhbr < input->num_nhbrs[i]; ++nhbr) {
+            if (nhbr_ids[nhbr] < i) {
+                taken_by[colors[nhbr_ids[nhbr]]] = i;
+            }
+        }
+        for (Offset reader = reader_starts[i]; reader < reader_starts[i + 1]; ++reader) {
+            taken_by[colors[readers_of[reader]]] = i;
+        }
+        Count color = 0;
+        while (taken_by[color] == i) {
+            ++color;
+        }
+        colors[i]  = color;
+        num_colors = (color + 1 > num_colors) ? color + 1 : num_colors;
+    }
+    free(readers_of);
+    free(reader_starts);
+
+    /**
+     * Counting sort by color, keeping id order within a class
+     */
+    ColorClasses* classes = arenaAlloc(input->arena, sizeof(*classes));
+    classes->num_colors   = num_colors;
+    classes->starts       = arenaAlloc(input->arena, (num_colors + 1) * sizeof(*classes->starts));
+    memset(classes->starts, 0, (num_colors + 1) * sizeof(*classes->starts));
+    for (Count i = 0; i < N; ++i) {
+        ++classes->starts[colors[i] + 1];
+    }
+    for (Count c = 0; c < num_colors; ++c) {
+        classes->starts[c + 1] += classes->starts[c];
+    }
+
+    Count* order = malloc(N * sizeof(*order));
+    Count* next  = taken_by;
+    memcpy(next, classes->starts, num_colors * sizeof(*next));
+    for (Count i = 0; i < N; ++i) {
+        order[next[colors[i]]++] = i;
+    }
+    applyOrder(input, order);
+
+    free(order);
+    free(taken_by);
+    free(colors);
+    return classes;
+}
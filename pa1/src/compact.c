@@ -0,0 +1,140 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+#include "compact.h"
+
+/**
+ * {@inheritDoc}
+ */
+int compactEnabled() {
+    const char* enabled = getenv(COMPACT_ENV);
+    return (enabled != NULL) && (*enabled != '\0') && (strcmp(enabled, "0") != 0);
+}
+
+/**
+ * {@inheritDoc}
+ */
+CompactGrid* buildCompactGrid(const AMRInput* input, float affect_rate,
+                              const Weight* diag_weights, Arena* arena) {
+    /**
+     * Pick the overlap width from the largest overlap
+     */
+    Coord max_overlap = 0;
+    for (Offset k = 0; k < input->total_nhbrs; ++k) {
+        max_overlap = (input->overlaps[k] > max_overlap) ? input->overlaps[k] : max_overlap;
+    }
+    if (max_overlap > UINT16_MAX) {
+        return NULL;
+    }
+
+    CompactGrid* compact = arenaAlloc(arena, sizeof(*compact));
+    compact->N             = input->N;
+    compact->total_nhbrs   = input->total_nhbrs;
+    compact->overlap_bytes = (max_overlap > UINT8_MAX) ? 2 : 1;
+    compact->overlaps8     = NULL;
+    compact->overlaps16    = NULL;
+    compact->nhbr_deltas   = arenaAlloc(arena, input->total_nhbrs * sizeof(*compact->nhbr_deltas));
+    if (compact->overlap_bytes == 1) {
+        compact->overlaps8 = arenaAlloc(arena, input->total_nhbrs * sizeof(*compact->overlaps8));
+    } else {
+        compact->overlaps16 = arenaAlloc(arena, input->total_nhbrs * sizeof(*compact->overlaps16));
+    }
+
+    /**
+     * Encode neighbor ids as deltas, moving far ones to the far list
+     */
+    compact->num_far = 0;
+    for (Count i = 0; i < input->N; ++i) {
+        for (Offset k = input->offsets[i]; k < input->offsets[i] + input->num_nhbrs[i]; ++k) {
+            long long delta = (long long) input->nhbr_ids[k] - i;
+            compact->num_far += (delta < -INT16_MAX) || (delta > INT16_MAX);
+        }
+    }
+    compact->far_rows     = arenaAlloc(arena, compact->num_far * sizeof(*compact->far_rows));
+    compact->far_ids      = arenaAlloc(arena, compact->num_far * sizeof(*compact->far_ids));
+    compact->far_overlaps = arenaAlloc(arena, compact->num_far * sizeof(*compact->far_overlaps));
+    Offset far = 0;
+    for (Count i = 0; i < input->N; ++i) {
+        for (Offset k = input->offsets[i]; k < input->offsets[i] + input->num_nhbrs[i]; ++k) {
+            long long delta   = (long long) input->nhbr_ids[k] - i;
+            Coord     overlap = input->overlaps[k];
+            if ((delta < -INT16_MAX) || (delta > INT16_MAX)) {
+                compact->far_rows[far]     = i;
+                compact->far_ids[far]      = input->nhbr_ids[k];
+                compact->far_overlaps[far] = overlap;
+                ++far;
+                delta   = 0;
+                overlap = 0;
+            }
+            compact->nhbr_deltas[k] = delta;
+            if (compact->overlap_bytes == 1) {
+                compact->overlaps8[k] = overlap;
+            } else {
+                compact->overlaps16[k] = overlap;
+            }
+        }
+    }
+
+    compact->diag_weights = arenaAlloc(arena, input->N * sizeof(*compact->diag_weights));
+    compact->scales       = arenaAlloc(arena, input->N * sizeof(*compact->scales));
+    for (Count i = 0; i < input->N; ++i) {
+        compact->diag_weights[i] = diag_weights[i];
+        compact->scales[i]       = (double) affect_rate / input->perimeters[i];
+    }
+    return compact;
+}
+
+/**
+ * {@inheritDoc}
+ */
+size_t compactBytes(const CompactGrid* compact) {
+    return compact->N * (sizeof(Count) + sizeof(Offset) + 2 * sizeof(Weight))
+         + compact->total_nhbrs * (sizeof(*compact->nhbr_deltas) + compact->overlap_bytes)
+         + compact->num_far * (sizeof(*compact->far_rows) + sizeof(*compact->far_ids) + sizeof(*compact->far_overlaps));
+}
+
+/**
+ * Updates every box with 8-bit overlaps
+ */
+static void compactUpdate8(const AMRInput* input, const CompactGrid* compact, const DSV* vals, DSV* updated_vals) {
+    for (Count i = 0; i < input->N; ++i) {
+        const int16_t* deltas   = &compact->nhbr_deltas[input->offsets[i]];
+        const uint8_t* overlaps = &compact->overlaps8[input->offsets[i]];
+        DSV sum = 0;
+        for (Count nhbr = 0; nhbr < input->num_nhbrs[i]; ++nhbr) {
+            sum += overlaps[nhbr] * vals[i + deltas[nhbr]];
+        }
+        updated_vals[i] = compact->diag_weights[i] * vals[i] + compact->scales[i] * sum;
+    }
+}
+
+/**
+ * Updates every box with 16-bit overlaps
+ */
+static void compactUpdate16(const AMRInput* input, const CompactGrid* compact, const DSV* vals, DSV* updated_vals) {
+    for (Count i = 0; i < input->N; ++i) {
+        const int16_t*  deltas   = &compact->nhbr_deltas[input->offsets[i]];
+        const uint16_t* overlaps = &compact->overlaps16[input->offsets[i]];
+        DSV sum = 0;
+        for (Count nhbr = 0; nhbr < input->num_nhbrs[i]; ++nhbr) {
+            sum += overlaps[nhbr] * vals[i + deltas[nhbr]];
+        }
+        updated_vals[i] = compact->diag_weights[i] * vals[i] + compact->scales[i] * sum;
+    }
+}
+
+/**
+ * {@inheritDoc}
+ */
+void compactUpdate(const AMRInput* input, const CompactGrid* compact, const DSV* vals, DSV* updated_vals) {
+    if (compact->overlap_bytes == 1) {
+        compactUpdate8(input, compact, vals, updated_vals);
+    } else {
+        compactUpdate16(input, compact, vals, updated_vals);
+    }
+    for (Offset far = 0; far < compact->num_far; ++far) {
+        Count row = compact->far_rows[far];
+        updated_vals[row] += compact->scales[row] * (compact->far_overlaps[far] * vals[compact->far_ids[far]]);
+    }
+}
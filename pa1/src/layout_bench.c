@@ -0,0 +1,611 @@
+#include <linux/perf_event.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "arena.h"
+#include "color.h"
+#include "common.h"
+#include "compact.h"
+#include "ingest.h"
+#include "patch.h"
+#include "reorder.h"
+#include "sell.h"
+#include "simd.h"
+#include "temporal.h"
+
+const char* usage = "\
+Usage: amr-layout-bench [affect-rate] [iterations] [test-file | --stdin]\n\
+\n\
+affect-rate: float value controlling the effect of neighboring boxes\n\
+iterations : number of iterations to time per layout\n\
+test-file  : test file with input to AMR problem (text or compiled)\n\
+--stdin    : read input from stdin instead\n";
+
+/**
+ * Opens a counter of this process's data TLB read misses, started
+ *
+ * @return the counter's file descriptor, or -1 if the hardware
+ *         (or the virtual machine) does not expose one
+ */
+static int openTLBCounter() {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size           = sizeof(attr);
+    attr.type           = PERF_TYPE_HW_CACHE;
+    attr.config         = PERF_COUNT_HW_CACHE_DTLB
+                        | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+                        | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    attr.exclude_kernel = 1;
+    attr.exclude_hv     = 1;
+    return syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+/**
+ * Reads a counter opened by {@code openTLBCounter()} and closes it
+ *
+ * @return the count, or -1 if there is no counter
+ */
+static long long closeTLBCounter(int fd) {
+    long long count = -1;
+    if (fd >= 0) {
+        if (read(fd, &count, sizeof(count)) != sizeof(count)) {
+            count = -1;
+        }
+        close(fd);
+    }
+    return count;
+}
+
+/**
+ * Anonymous memory of this process backed by transparent huge pages,
+ * in kB (from /proc/self/smaps_rollup), or -1 if unknown
+ */
+static long long hugePageKB() {
+    FILE* smaps = fopen("/proc/self/smaps_rollup", "r");
+    if (smaps == NULL) {
+        return -1;
+    }
+    char      line[256];
+    long long kb = -1;
+    while (fgets(line, sizeof(line), smaps) != NULL) {
+        if (sscanf(line, "AnonHugePages: %lld kB", &kb) == 1) {
+            break;
+        }
+    }
+    fclose(smaps);
+    return kb;
+}
+
+/**
+ * Per-box struct layout the solvers used before the CSR arrays,
+ * each box's neighbor ids and overlaps in their own allocations
+ */
+typedef struct BoxData {
+    Coord perimeter;
+    Count id;
+
+    Count  num_nhbrs;
+    Count* nhbr_ids;
+    Coord* overlaps;
+    Coord  self_overlap;
+} BoxData;
+
+/**
+ * Builds the per-box struct layout of a grid
+ */
+static BoxData* buildBoxes(const AMRInput* input) {
+    BoxData* boxes = malloc(input->N * sizeof(*boxes));
+    for (Count i = 0; i < input->N; ++i) {
+        BoxData* box = &boxes[i];
+        box->perimeter    = input->perimeters[i];
+        box->id           = i;
+        box->num_nhbrs    = input->num_nhbrs[i];
+        box->nhbr_ids     = malloc(box->num_nhbrs * sizeof(*box->nhbr_ids));
+        box->overlaps     = malloc(box->num_nhbrs * sizeof(*box->overlaps));
+        box->self_overlap = input->self_overlaps[i];
+        memcpy(box->nhbr_ids, &input->nhbr_ids[input->offsets[i]], box->num_nhbrs * sizeof(*box->nhbr_ids));
+        memcpy(box->overlaps, &input->overlaps[input->offsets[i]], box->num_nhbrs * sizeof(*box->overlaps));
+    }
+    return boxes;
+}
+
+/**
+ * Runs {@code iterations} iterations with the per-box struct layout
+ *
+ * @param vals         initial DSVs, overwritten with the final DSVs
+ * @param updated_vals room for {@code N} DSVs
+ * @return wall-clock seconds spent
+ */
+static double runBoxes(const AMRInput* input, const BoxData* boxes, float affect_rate,
+                       unsigned long iterations, DSV* vals, DSV* updated_vals) {
+    struct timespec before;
+    clock_gettime(CLOCK_REALTIME, &before);
+    for (unsigned long iter = 0; iter < iterations; ++iter) {
+        for (Count i = 0; i < input->N; ++i) {
+            const BoxData* box = &boxes[i];
+            DSV updated = box->self_overlap * vals[i];
+            for (Count nhbr = 0; nhbr < box->num_nhbrs; ++nhbr) {
+                updated += box->overlaps[nhbr] * vals[box->nhbr_ids[nhbr]];
+            }
+            updated /= box->perimeter;
+            updated_vals[i] = vals[i] * (1 - affect_rate) + updated * affect_rate;
+        }
+        memcpy(vals, updated_vals, input->N * sizeof(*vals));
+    }
+    return secondsSince(before);
+}
+
+/**
+ * Runs {@code iterations} iterations with the CSR arrays
+ *
+ * @param vals         initial DSVs, overwritten with the final DSVs
+ * @param updated_vals room for {@code N} DSVs
+ * @return wall-clock seconds spent
+ */
+static double runCSR(const AMRInput* input, float affect_rate,
+                     unsigned long iterations, DSV* vals, DSV* updated_vals) {
+    struct timespec before;
+    clock_gettime(CLOCK_REALTIME, &before);
+    for (unsigned long iter = 0; iter < iterations; ++iter) {
+        for (Count i = 0; i < input->N; ++i) {
+            const Count* nhbr_ids = &input->nhbr_ids[input->offsets[i]];
+            const Coord* overlaps = &input->overlaps[input->offsets[i]];
+            DSV updated = input->self_overlaps[i] * vals[i];
+            for (Count nhbr = 0; nhbr < input->num_nhbrs[i]; ++nhbr) {
+                updated += overlaps[nhbr] * vals[nhbr_ids[nhbr]];
+            }
+            updated /= input->perimeters[i];
+            updated_vals[i] = vals[i] * (1 - affect_rate) + updated * affect_rate;
+        }
+        memcpy(vals, updated_vals, input->N * sizeof(*vals));
+    }
+    return secondsSince(before);
+}
+
+/**
+ * Runs {@code iterations} iterations with the CSR arrays
+ * and precomputed weights (see {@code computeWeightRange()})
+ *
+ * @param vals         initial DSVs, overwritten with the final DSVs
+ * @param updated_vals room for {@code N} DSVs
+ * @return wall-clock seconds spent
+ */
+static double runWeights(const AMRInput* input, const Weight* diag_weights, const Weight* nhbr_weights,
+                         unsigned long iterations, DSV* vals, DSV* updated_vals) {
+    struct timespec before;
+    clock_gettime(CLOCK_REALTIME, &before);
+    for (unsigned long iter = 0; iter < iterations; ++iter) {
+        for (Count i = 0; i < input->N; ++i) {
+            const Count*  nhbr_ids = &input->nhbr_ids[input->offsets[i]];
+            const Weight* weights  = &nhbr_weights[input->offsets[i]];
+            DSV updated = diag_weights[i] * vals[i];
+            for (Count nhbr = 0; nhbr < input->num_nhbrs[i]; ++nhbr) {
+                updated += weights[nhbr] * vals[nhbr_ids[nhbr]];
+            }
+            updated_vals[i] = updated;
+        }
+        memcpy(vals, updated_vals, input->N * sizeof(*vals));
+    }
+    return secondsSince(before);
+}
+
+/**
+ * Times {@code iterations} updates with an update kernel, in seconds
+ */
+static double runKernel(const AMRInput* input, UpdateKernel kernel, const Weight* diag_weights,
+                        const Weight* nhbr_weights, unsigned long iterations, DSV* vals, DSV* updated_vals) {
+    struct timespec before;
+    clock_gettime(CLOCK_REALTIME, &before);
+    for (unsigned long iter = 0; iter < iterations; ++iter) {
+        kernel(input, diag_weights, nhbr_weights, 0, input->N, vals, updated_vals);
+        memcpy(vals, updated_vals, input->N * sizeof(*vals));
+    }
+    return secondsSince(before);
+}
+
+/**
+ * Times {@code iterations / steps} temporally blocked sweeps, in seconds
+ */
+static double runTemporalSweeps(const TemporalGrid* grid, Count N, unsigned long iterations,
+                                DSV* vals, DSV* updated_vals) {
+    struct timespec before;
+    clock_gettime(CLOCK_REALTIME, &before);
+    for (unsigned long iter = 0; iter + grid->steps <= iterations; iter += grid->steps) {
+        temporalSweep(grid, vals, updated_vals);
+        memcpy(vals, updated_vals, N * sizeof(*vals));
+    }
+    return secondsSince(before);
+}
+
+/**
+ * Runs {@code iterations} iterations with the SELL-C-sigma grid
+ *
+ * @param vals         initial DSVs, overwritten with the final DSVs
+ * @param updated_vals room for {@code N} DSVs
+ * @return wall-clock seconds spent
+ */
+static double runSell(const SellGrid* sell, unsigned long iterations, DSV* vals, DSV* updated_vals) {
+    struct timespec before;
+    clock_gettime(CLOCK_REALTIME, &before);
+    for (unsigned long iter = 0; iter < iterations; ++iter) {
+        sellUpdate(sell, vals, updated_vals);
+        memcpy(vals, updated_vals, sell->N * sizeof(*vals));
+    }
+    return secondsSince(before);
+}
+
+/**
+ * Runs {@code iterations} iterations with the compact topology
+ *
+ * @param vals         initial DSVs, overwritten with the final DSVs
+ * @param updated_vals room for {@code N} DSVs
+ * @return wall-clock seconds spent
+ */
+static double runCompact(const AMRInput* input, const CompactGrid* compact,
+                         unsigned long iterations, DSV* vals, DSV* updated_vals) {
+    struct timespec before;
+    clock_gettime(CLOCK_REALTIME, &before);
+    for (unsigned long iter = 0; iter < iterations; ++iter) {
+        compactUpdate(input, compact, vals, updated_vals);
+        memcpy(vals, updated_vals, input->N * sizeof(*vals));
+    }
+    return secondsSince(before);
+}
+
+/**
+ * Times {@code iterations} structured-patch updates, in seconds
+ */
+static double runPatches(const AMRInput* input, const PatchSet* patches,
+                         const Weight* diag_weights, const Weight* nhbr_weights,
+                         unsigned long iterations, DSV* vals, DSV* updated_vals) {
+    struct timespec before;
+    clock_gettime(CLOCK_REALTIME, &before);
+    for (unsigned long iter = 0; iter < iterations; ++iter) {
+        patchUpdate(patches, input, diag_weights, nhbr_weights, vals, updated_vals);
+        memcpy(vals, updated_vals, input->N * sizeof(*vals));
+    }
+    return secondsSince(before);
+}
+
+/**
+ * Times {@code iterations} in-place Gauss-Seidel sweeps, one color class at a time, in seconds
+ */
+static double runGaussSeidel(const AMRInput* input, const ColorClasses* colors, UpdateKernel kernel,
+                             const Weight* diag_weights, const Weight* nhbr_weights,
+                             unsigned long iterations, DSV* vals) {
+    struct timespec before;
+    clock_gettime(CLOCK_REALTIME, &before);
+    for (unsigned long iter = 0; iter < iterations; ++iter) {
+        for (Count c = 0; c < colors->num_colors; ++c) {
+            kernel(input, diag_weights, nhbr_weights, colors->starts[c], colors->starts[c + 1], vals, vals);
+        }
+    }
+    return secondsSince(before);
+}
+
+/**
+ * Largest relative difference of {@code N} DSVs from {@code expected}
+ */
+static double maxRelativeError(Count N, const DSV* vals, const DSV* expected) {
+    double max_error = 0;
+    for (Count i = 0; i < N; ++i) {
+        double error = (vals[i] - expected[i]) / expected[i];
+        error = (error < 0) ? -error : error;
+        if (error > max_error) {
+            max_error = error;
+        }
+    }
+    return max_error;
+}
+
+int main(int argc, char** argv) {
+    /**
+     * Parse command-line arguments
+     */
+    if ((argc != 3) && (argc != 4)) {
+        printf("%s", usage);
+        exit(1);
+    }
+    float         affect_rate = strtof(argv[1], NULL);
+    unsigned long iterations  = strtoul(argv[2], NULL, 10);
+    if (iterations < 1) {
+        printf("Invalid parameters\n");
+        printf("%s", usage);
+        exit(1);
+    }
+
+    const char* test_file = NULL;
+    if ((argc == 4) && (strcmp(argv[3], "--stdin") != 0)) {
+        test_file = argv[3];
+    }
+
+    AMRInput* input = parseInput(test_file, parseThreads());
+    BoxData*  boxes = buildBoxes(input);
+
+    /**
+     * All layouts start from the same DSVs
+     */
+    DSV* box_vals     = arenaAlloc(input->arena, input->N * sizeof(*box_vals));
+    DSV* csr_vals     = arenaAlloc(input->arena, input->N * sizeof(*csr_vals));
+    DSV* weight_vals  = arenaAlloc(input->arena, input->N * sizeof(*weight_vals));
+    DSV* updated_vals = arenaAlloc(input->arena, input->N * sizeof(*updated_vals));
+    memcpy(box_vals, input->vals, input->N * sizeof(*box_vals));
+    memcpy(csr_vals, input->vals, input->N * sizeof(*csr_vals));
+    memcpy(weight_vals, input->vals, input->N * sizeof(*weight_vals));
+
+    double box_seconds = runBoxes(input, boxes, affect_rate, iterations, box_vals, updated_vals);
+    double csr_seconds = runCSR(input, affect_rate, iterations, csr_vals, updated_vals);
+    if (memcmp(box_vals, csr_vals, input->N * sizeof(*box_vals)) != 0) {
+        fprintf(stderr, "Error: layouts disagree\n");
+        exit(1);
+    }
+
+    /**
+     * Weights round differently, so they are only compared
+     * against the CSR result (largest relative difference)
+     */
+    struct timespec setup_before;
+    clock_gettime(CLOCK_REALTIME, &setup_before);
+    Weight* diag_weights = arenaAlloc(input->arena, input->N * sizeof(*diag_weights));
+    Weight* nhbr_weights = arenaAlloc(input->arena, input->total_nhbrs * sizeof(*nhbr_weights));
+    computeWeightRange(input, affect_rate, 0, input->N, diag_weights, nhbr_weights);
+    double setup_seconds  = secondsSince(setup_before);
+    int       tlb_counter    = openTLBCounter();
+    double    weight_seconds = runWeights(input, diag_weights, nhbr_weights, iterations, weight_vals, updated_vals);
+    long long tlb_misses     = closeTLBCounter(tlb_counter);
+    long long huge_page_kb   = hugePageKB();
+
+    double max_error = maxRelativeError(input->N, weight_vals, csr_vals);
+
+    /**
+     * Time each update kernel the CPU supports, which
+     * all give the same DSVs as the weights
+     */
+    SimdKind simd_supported = simdSupported();
+    double   simd_seconds[SIMD_AVX512 + 1];
+    for (SimdKind kind = SIMD_SCALAR; kind <= simd_supported; ++kind) {
+        DSV* simd_vals = arenaAlloc(input->arena, input->N * sizeof(*simd_vals));
+        memcpy(simd_vals, input->vals, input->N * sizeof(*simd_vals));
+        simd_seconds[kind] = runKernel(input, updateKernel(kind), diag_weights, nhbr_weights,
+                                       iterations, simd_vals, updated_vals);
+        if (memcmp(simd_vals, weight_vals, input->N * sizeof(*simd_vals)) != 0) {
+            fprintf(stderr, "Error: %s kernel disagrees\n", simdName(kind));
+            exit(1);
+        }
+    }
+
+    /**
+     * Time temporal blocking with a few block depths, which gives the
+     * same DSVs as the weights when the depth divides the iterations
+     */
+    Count         depths[]   = { 2, 4, 8 };
+    int           num_depths = sizeof(depths) / sizeof(*depths);
+    TemporalGrid* temporals[3];
+    double        temporal_seconds[3];
+    for (int k = 0; k < num_depths; ++k) {
+        temporals[k] = buildTemporalGrid(input, depths[k], diag_weights, nhbr_weights, input->arena);
+
+        DSV* temporal_vals = arenaAlloc(input->arena, input->N * sizeof(*temporal_vals));
+        memcpy(temporal_vals, input->vals, input->N * sizeof(*temporal_vals));
+        temporal_seconds[k] = runTemporalSweeps(temporals[k], input->N, iterations, temporal_vals, updated_vals);
+        if ((iterations % depths[k] == 0)
+            && (memcmp(temporal_vals, weight_vals, input->N * sizeof(*temporal_vals)) != 0)) {
+            fprintf(stderr, "Error: temporal blocking disagrees\n");
+            exit(1);
+        }
+    }
+
+    /**
+     * Time the SELL-C-sigma update without sorting, with the default
+     * window and with one window over the whole grid (least padding)
+     */
+    Count     sigmas[] = { 1, 256, input->N };
+    int       num_sigmas = sizeof(sigmas) / sizeof(*sigmas);
+    SellGrid* sells[3];
+    double    sell_seconds[3];
+    for (int k = 0; k < num_sigmas; ++k) {
+        sells[k] = buildSellGrid(input, sigmas[k], diag_weights, nhbr_weights, input->arena);
+
+        DSV* sell_vals = arenaAlloc(input->arena, input->N * sizeof(*sell_vals));
+        memcpy(sell_vals, input->vals, input->N * sizeof(*sell_vals));
+        sell_seconds[k] = runSell(sells[k], iterations, sell_vals, updated_vals);
+        if (memcmp(sell_vals, weight_vals, input->N * sizeof(*sell_vals)) != 0) {
+            fprintf(stderr, "Error: SELL-C-sigma disagrees\n");
+            exit(1);
+        }
+    }
+
+    /**
+     * Time the compact topology (if the overlaps fit in 16 bits),
+     * which rounds like the CSR update rather than the weights
+     */
+    CompactGrid* compact           = buildCompactGrid(input, affect_rate, diag_weights, input->arena);
+    double       compact_seconds   = 0;
+    double       compact_max_error = 0;
+    if (compact != NULL) {
+        DSV* compact_vals = arenaAlloc(input->arena, input->N * sizeof(*compact_vals));
+        memcpy(compact_vals, input->vals, input->N * sizeof(*compact_vals));
+        compact_seconds   = runCompact(input, compact, iterations, compact_vals, updated_vals);
+        compact_max_error = maxRelativeError(input->N, compact_vals, csr_vals);
+    }
+    size_t weight_bytes = input->N * (sizeof(Count) + sizeof(Offset) + sizeof(Weight))
+                        + input->total_nhbrs * (sizeof(Count) + sizeof(Weight));
+
+    /**
+     * Time the weighted kernel again with each box ordering,
+     * mapping the final DSVs back to compare with the run above
+     */
+    ReorderKind kinds[]     = { REORDER_HILBERT, REORDER_RCM };
+    int         num_kinds   = sizeof(kinds) / sizeof(*kinds);
+    GridProfile profiles[2] = { 0 };
+    double      reorder_setup_seconds[2];
+    double      reorder_seconds[2];
+    GridProfile loaded_profile = measureProfile(input);
+    DSV*        restored_vals  = arenaAlloc(input->arena, input->N * sizeof(*restored_vals));
+    for (int k = 0; k < num_kinds; ++k) {
+        /**
+         * Renumber relative to the grid as loaded here (which may already
+         * be reordered by AMR_REORDER), restoring it afterwards
+         */
+        AMRInput loaded = *input;
+        input->order    = NULL;
+
+        struct timespec reorder_before;
+        clock_gettime(CLOCK_REALTIME, &reorder_before);
+        applyOrder(input, computeOrder(input, kinds[k], input->arena));
+        reorder_setup_seconds[k] = secondsSince(reorder_before);
+        profiles[k] = measureProfile(input);
+
+        DSV* reordered_vals = arenaAlloc(input->arena, input->N * sizeof(*reordered_vals));
+        memcpy(reordered_vals, input->vals, input->N * sizeof(*reordered_vals));
+        computeWeightRange(input, affect_rate, 0, input->N, diag_weights, nhbr_weights);
+        reorder_seconds[k] = runWeights(input, diag_weights, nhbr_weights, iterations, reordered_vals, updated_vals);
+
+        restoreOrder(input, reordered_vals, restored_vals);
+        if (memcmp(restored_vals, weight_vals, input->N * sizeof(*restored_vals)) != 0) {
+            fprintf(stderr, "Error: orderings disagree\n");
+            exit(1);
+        }
+        *input = loaded;
+    }
+
+    /**
+     * Time the structured-patch update the same way, which sums each
+     * stencil in its own order (largest relative difference)
+     */
+    AMRInput loaded = *input;
+    input->order    = NULL;
+
+    struct timespec patch_before;
+    clock_gettime(CLOCK_REALTIME, &patch_before);
+    PatchSet* patches = buildPatches(input);
+    computeWeightRange(input, affect_rate, 0, input->N, diag_weights, nhbr_weights);
+    setPatchWeights(patches, input, diag_weights, nhbr_weights);
+    double patch_setup_seconds = secondsSince(patch_before);
+
+    DSV* patch_vals = arenaAlloc(input->arena, input->N * sizeof(*patch_vals));
+    memcpy(patch_vals, input->vals, input->N * sizeof(*patch_vals));
+    double patch_seconds = runPatches(input, patches, diag_weights, nhbr_weights, iterations, patch_vals, updated_vals);
+    restoreOrder(input, patch_vals, restored_vals);
+    double patch_max_error = maxRelativeError(input->N, restored_vals, weight_vals);
+    *input = loaded;
+
+    /**
+     * Time Gauss-Seidel sweeps by color class (different
+     * DSVs from the weights, so nothing to compare)
+     */
+    input->order = NULL;
+
+    struct timespec color_before;
+    clock_gettime(CLOCK_REALTIME, &color_before);
+    ColorClasses* colors = colorBoxes(input);
+    computeWeightRange(input, affect_rate, 0, input->N, diag_weights, nhbr_weights);
+    double color_setup_seconds = secondsSince(color_before);
+
+    DSV* color_vals = arenaAlloc(input->arena, input->N * sizeof(*color_vals));
+    memcpy(color_vals, input->vals, input->N * sizeof(*color_vals));
+    double color_seconds = runGaussSeidel(input, colors, updateKernel(SIMD_SCALAR), diag_weights, nhbr_weights,
+                                          iterations, color_vals);
+    *input = loaded;
+
+    double updates = (double) (input->N + input->total_nhbrs) * iterations;
+    printf("========================================\n");
+    printf("grid:\n");
+    printf("=> boxes      "COUNT_SPEC"\n", input->N);
+    printf("=> nhbrs      "OFFSET_SPEC"\n", input->total_nhbrs);
+    printf("=> iterations %lu\n", iterations);
+    printf("\nboxes (per-box structs):\n");
+    printf("=> seconds-per-iter %lf\n", box_seconds / iterations);
+    printf("=> Mupdates-per-sec %lf\n", updates / 1000000.0 / box_seconds);
+    printf("\ncsr (flat arrays):\n");
+    printf("=> seconds-per-iter %lf\n", csr_seconds / iterations);
+    printf("=> Mupdates-per-sec %lf\n", updates / 1000000.0 / csr_seconds);
+    printf("=> speedup          %lf\n", box_seconds / csr_seconds);
+    printf("\nweights (%zu-byte, precomputed):\n", sizeof(Weight));
+    printf("=> setup-seconds    %lf\n", setup_seconds);
+    printf("=> seconds-per-iter %lf\n", weight_seconds / iterations);
+    printf("=> Mupdates-per-sec %lf\n", updates / 1000000.0 / weight_seconds);
+    printf("=> speedup          %lf\n", box_seconds / weight_seconds);
+    printf("=> max-rel-error    %e\n", max_error);
+    if (tlb_misses >= 0) {
+        printf("=> dTLB-misses-per-iter %lf\n", (double) tlb_misses / iterations);
+    } else {
+        printf("=> dTLB-misses-per-iter unavailable\n");
+    }
+    printf("\nmemory:\n");
+    const char* page_modes[] = { "off", "thp", "hugetlb" };
+    printf("=> huge-pages      %s\n", page_modes[hugePageMode()]);
+    printf("=> huge-page-MB    %lf\n", huge_page_kb / 1000.0);
+    for (SimdKind kind = SIMD_SCALAR; kind <= simd_supported; ++kind) {
+        printf("\n%s kernel (weights):\n", simdName(kind));
+        printf("=> seconds-per-iter %lf\n", simd_seconds[kind] / iterations);
+        printf("=> Mupdates-per-sec %lf\n", updates / 1000000.0 / simd_seconds[kind]);
+        printf("=> speedup          %lf (vs. weights)\n", weight_seconds / simd_seconds[kind]);
+    }
+    for (int k = 0; k < num_depths; ++k) {
+        unsigned long swept = iterations / depths[k] * depths[k];
+        printf("\ntemporal blocking (%u iterations per block, weights):\n", depths[k]);
+        printf("=> blocks           "COUNT_SPEC"\n", temporals[k]->num_blocks);
+        printf("=> ghost-boxes      %lf (per box)\n", (double) temporals[k]->num_ghosts / input->N);
+        printf("=> seconds-per-iter %lf\n", temporal_seconds[k] / swept);
+        printf("=> speedup          %lf (vs. weights)\n", (weight_seconds / iterations) / (temporal_seconds[k] / swept));
+    }
+    for (int k = 0; k < num_sigmas; ++k) {
+        printf("\nsell-c-sigma (C "COUNT_SPEC", sigma "COUNT_SPEC", weights):\n", (Count) SELL_C, sells[k]->sigma);
+        printf("=> padding          %lf\n", (double) sellEntries(sells[k]) / input->total_nhbrs - 1);
+        printf("=> seconds-per-iter %lf\n", sell_seconds[k] / iterations);
+        printf("=> Mupdates-per-sec %lf\n", updates / 1000000.0 / sell_seconds[k]);
+        printf("=> speedup          %lf (vs. weights)\n", weight_seconds / sell_seconds[k]);
+    }
+    printf("\ncompact (16-bit ids, narrow overlaps):\n");
+    if (compact != NULL) {
+        printf("=> overlap-bytes    %d\n", compact->overlap_bytes);
+        printf("=> far-nhbrs        "OFFSET_SPEC"\n", compact->num_far);
+        printf("=> MB-per-iter      %lf (weights %lf)\n", compactBytes(compact) / 1000000.0, weight_bytes / 1000000.0);
+        printf("=> seconds-per-iter %lf\n", compact_seconds / iterations);
+        printf("=> Mupdates-per-sec %lf\n", updates / 1000000.0 / compact_seconds);
+        printf("=> speedup          %lf (vs. weights)\n", weight_seconds / compact_seconds);
+        printf("=> max-rel-error    %e (vs. csr)\n", compact_max_error);
+    } else {
+        printf("=> overlaps do not fit in 16 bits\n");
+    }
+    printf("\nids as loaded:\n");
+    printf("=> bandwidth        "COUNT_SPEC"\n", loaded_profile.bandwidth);
+    printf("=> profile          %llu\n", loaded_profile.profile);
+    for (int k = 0; k < num_kinds; ++k) {
+        printf("\n%s order (weights):\n", reorderName(kinds[k]));
+        printf("=> bandwidth        "COUNT_SPEC"\n", profiles[k].bandwidth);
+        printf("=> profile          %llu\n", profiles[k].profile);
+        printf("=> setup-seconds    %lf\n", reorder_setup_seconds[k]);
+        printf("=> seconds-per-iter %lf\n", reorder_seconds[k] / iterations);
+        printf("=> speedup          %lf (vs. ids as loaded)\n", weight_seconds / reorder_seconds[k]);
+    }
+    printf("\npatches (5-point stencil, weights):\n");
+    printf("=> patches          "COUNT_SPEC"\n", patches->num_patches);
+    printf("=> stencil-boxes    %lf\n", 1 - (double) patches->num_rows / input->N);
+    printf("=> setup-seconds    %lf\n", patch_setup_seconds);
+    printf("=> seconds-per-iter %lf\n", patch_seconds / iterations);
+    printf("=> speedup          %lf (vs. weights)\n", weight_seconds / patch_seconds);
+    printf("=> max-rel-error    %e (vs. weights)\n", patch_max_error);
+    printf("\ngauss-seidel (in place by color class, scalar kernel):\n");
+    printf("=> colors           "COUNT_SPEC"\n", colors->num_colors);
+    printf("=> setup-seconds    %lf\n", color_setup_seconds);
+    printf("=> seconds-per-iter %lf\n", color_seconds / iterations);
+    printf("=> speedup          %lf (vs. scalar kernel)\n", simd_seconds[SIMD_SCALAR] / color_seconds);
+    printf("========================================\n\n");
+
+    /**
+     * Clean up
+     */
+    for (Count i = 0; i < input->N; ++i) {
+        free(boxes[i].nhbr_ids);
+        free(boxes[i].overlaps);
+    }
+    free(boxes);
+    destroyInput(input);
+    return 0;
+}
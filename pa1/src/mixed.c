@@ -0,0 +1,65 @@
+#include <float.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mixed.h"
+
+/**
+ * {@inheritDoc}
+ */
+int mixedEnabled() {
+    const char* enabled = getenv(MIXED_ENV);
+    return (enabled != NULL) && (*enabled != '\0') && (strcmp(enabled, "0") != 0);
+}
+
+/**
+ * {@inheritDoc}
+ */
+unsigned long runLowPrecision(const AMRInput* input, LowUpdateKernel kernel, const Weight* diag_weights,
+                              const Weight* nhbr_weights, float epsilon, AMRMaxMin* max_min,
+                              DSV* final_vals) {
+    Count   N            = input->N;
+    LowDSV* vals         = malloc(N * sizeof(*vals));
+    LowDSV* updated_vals = malloc(N * sizeof(*updated_vals));
+    LowDSV* low_diag     = malloc(N * sizeof(*low_diag));
+    LowDSV* low_nhbr     = malloc(input->total_nhbrs * sizeof(*low_nhbr));
+    for (Count i = 0; i < N; ++i) {
+        vals[i]     = input->vals[i];
+        low_diag[i] = diag_weights[i];
+    }
+    for (Offset k = 0; k < input->total_nhbrs; ++k) {
+        low_nhbr[k] = nhbr_weights[k];
+    }
+
+    /**
+     * The kernel tracks the extremal DSVs of each iteration, so the gap
+     * needs no pass of its own. The step that reaches the cutoff is
+     * dropped, leaving it and the rest of the approach to double.
+     */
+    LowMaxMin     range  = { max_min->max, max_min->min };
+    LowDSV        cutoff = epsilon + MIXED_GUARD * FLT_EPSILON;
+    unsigned long iter   = 0;
+    while ((range.max - range.min) / range.max > cutoff) {
+        LowMaxMin next = kernel(input, low_diag, low_nhbr, 0, N, vals, updated_vals);
+        if (!((next.max - next.min) / next.max > cutoff)) {
+            break;
+        }
+        LowDSV* temp = vals;
+        vals         = updated_vals;
+        updated_vals = temp;
+        range        = next;
+        ++iter;
+    }
+
+    for (Count i = 0; i < N; ++i) {
+        final_vals[i] = vals[i];
+    }
+    max_min->max = range.max;
+    max_min->min = range.min;
+
+    free(low_nhbr);
+    free(low_diag);
+    free(updated_vals);
+    free(vals);
+    return iter;
+}
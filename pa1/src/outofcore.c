@@ -0,0 +1,213 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "outofcore.h"
+
+/**
+ * Applies {@code advice} to the pages holding {@code bytes} bytes at {@code data}
+ */
+static void adviseRange(const void* data, size_t bytes, int advice) {
+    if (bytes == 0) {
+        return;
+    }
+    static size_t page_size = 0;
+    if (page_size == 0) {
+        page_size = sysconf(_SC_PAGESIZE);
+    }
+    uintptr_t start = (uintptr_t) data & ~(page_size - 1);
+    uintptr_t end   = (uintptr_t) data + bytes;
+    madvise((void*) start, end - start, advice);
+}
+
+/**
+ * Applies {@code advice} to every section of a window
+ */
+static void adviseWindow(OutOfCoreGrid* grid, Count window, int advice) {
+    GridWindow* range     = &grid->windows[window];
+    Count       num_boxes = range->end - range->start;
+    Offset      num_nhbrs = range->last_nhbr - range->first_nhbr;
+
+    adviseRange(&grid->perimeters[range->start], num_boxes * sizeof(Coord), advice);
+    adviseRange(&grid->num_nhbrs[range->start], num_boxes * sizeof(Count), advice);
+    adviseRange(&grid->offsets[range->start], num_boxes * sizeof(Offset), advice);
+    adviseRange(&grid->self_overlaps[range->start], num_boxes * sizeof(Coord), advice);
+    adviseRange(&grid->nhbr_ids[range->first_nhbr], num_nhbrs * sizeof(Count), advice);
+    adviseRange(&grid->overlaps[range->first_nhbr], num_nhbrs * sizeof(Coord), advice);
+}
+
+/**
+ * Reads a byte of each page holding {@code bytes} bytes at {@code data}
+ */
+static void faultRange(const void* data, size_t bytes) {
+    static size_t page_size = 0;
+    if (page_size == 0) {
+        page_size = sysconf(_SC_PAGESIZE);
+    }
+    const volatile char* pos = data;
+    const volatile char* end = pos + bytes;
+    if (bytes > 0) {
+        (void) *pos;
+    }
+    for (pos = (const volatile char*) (((uintptr_t) pos + page_size) & ~(page_size - 1));
+         pos < end; pos += page_size) {
+        (void) *pos;
+    }
+}
+
+/**
+ * Number of neighbors of all boxes before box {@code i} ({@code i} up to N)
+ */
+static inline Offset nhbrsBefore(const OutOfCoreGrid* grid, Count i) {
+    return (i < grid->N) ? grid->offsets[i] : grid->header->total_nhbrs;
+}
+
+/**
+ * Finds the end of the window starting at box {@code start}: at most
+ * {@code max_boxes} boxes, and boxes holding at most {@code max_nhbrs}
+ * neighbors (unless a single box already holds more)
+ */
+static Count findWindowEnd(const OutOfCoreGrid* grid, Count start, Count max_boxes, Count max_nhbrs) {
+    Count  lo    = start + 1;
+    Count  hi    = (grid->N - start > max_boxes) ? start + max_boxes : grid->N;
+    Offset limit = nhbrsBefore(grid, start) + max_nhbrs;
+
+    /**
+     * Last end in [lo, hi] whose neighbors still fit
+     */
+    while (lo < hi) {
+        Count mid = lo + (hi - lo + 1) / 2;
+        if (nhbrsBefore(grid, mid) <= limit) {
+            lo = mid;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    return lo;
+}
+
+/**
+ * {@inheritDoc}
+ */
+int outOfCoreEnabled() {
+    const char* enabled = getenv(OUT_OF_CORE_ENV);
+    return (enabled != NULL) && (*enabled != '\0') && (strcmp(enabled, "0") != 0);
+}
+
+/**
+ * {@inheritDoc}
+ */
+OutOfCoreGrid* openOutOfCoreGrid(const char* file_name) {
+    struct timespec parse_before;
+    clock_gettime(CLOCK_REALTIME, &parse_before);
+    InputBuffer* buffer = openInputBuffer(file_name);
+    if (!buffer->mapped || !isBinaryInput(buffer)) {
+        fprintf(stderr, "Error: out-of-core runs need a compiled grid file (see amr-compile)\n");
+        exit(1);
+    }
+
+    OutOfCoreGrid* grid = malloc(sizeof(*grid));
+    grid->source = buffer;
+    grid->header = checkBinaryHeader(buffer);
+    grid->N      = grid->header->N;
+
+    const char*       data   = buffer->data;
+    const AMRBHeader* header = grid->header;
+    grid->perimeters    = (const Coord*) (data + header->section_offsets[AMRB_PERIMETERS]);
+    grid->num_nhbrs     = (const Count*) (data + header->section_offsets[AMRB_NUM_NHBRS]);
+    grid->offsets       = (const Offset*) (data + header->section_offsets[AMRB_OFFSETS]);
+    grid->self_overlaps = (const Coord*) (data + header->section_offsets[AMRB_SELF_OVERLAPS]);
+    grid->nhbr_ids      = (const Count*) (data + header->section_offsets[AMRB_NHBR_IDS]);
+    grid->overlaps      = (const Coord*) (data + header->section_offsets[AMRB_OVERLAPS]);
+
+    /**
+     * The topology is checked once up front, then dropped
+     * again until its windows are swept
+     */
+    checkBinaryData(header, data);
+    for (int section = AMRB_PERIMETERS; section <= AMRB_NHBR_IDS; ++section) {
+        adviseRange(data + header->section_offsets[section], header->section_bytes[section], MADV_DONTNEED);
+    }
+
+    /**
+     * Half of a window goes to the per-box sections,
+     * half to the per-neighbor sections
+     */
+    Count max_boxes = OUT_OF_CORE_WINDOW_BYTES / 2 / (2 * sizeof(Coord) + sizeof(Count) + sizeof(Offset));
+    Count max_nhbrs = OUT_OF_CORE_WINDOW_BYTES / 2 / (sizeof(Count) + sizeof(Coord));
+    Count capacity  = 16;
+    grid->windows      = malloc(capacity * sizeof(*grid->windows));
+    grid->num_windows  = 0;
+    grid->window_bytes = 0;
+    for (Count start = 0; start < grid->N; ) {
+        Count end = findWindowEnd(grid, start, max_boxes, max_nhbrs);
+        if (grid->num_windows == capacity) {
+            capacity     *= 2;
+            grid->windows = realloc(grid->windows, capacity * sizeof(*grid->windows));
+        }
+        GridWindow* window = &grid->windows[grid->num_windows++];
+        window->start      = start;
+        window->end        = end;
+        window->first_nhbr = nhbrsBefore(grid, start);
+        window->last_nhbr  = nhbrsBefore(grid, end);
+        start = end;
+    }
+    for (int section = AMRB_PERIMETERS; section <= AMRB_OVERLAPS; ++section) {
+        grid->window_bytes += header->section_bytes[section];
+    }
+
+    /**
+     * DSVs are updated during the run, so they get a private copy
+     */
+    const void* vals = data + header->section_offsets[AMRB_VALS];
+    grid->vals = malloc(header->section_bytes[AMRB_VALS]);
+    memcpy(grid->vals, vals, header->section_bytes[AMRB_VALS]);
+    adviseRange(vals, header->section_bytes[AMRB_VALS], MADV_DONTNEED);
+    adviseRange(grid->offsets, header->section_bytes[AMRB_OFFSETS], MADV_DONTNEED);
+
+    grid->parse_bytes   = header->section_bytes[AMRB_VALS];
+    grid->parse_seconds = secondsSince(parse_before);
+    return grid;
+}
+
+/**
+ * {@inheritDoc}
+ */
+void prefetchWindow(OutOfCoreGrid* grid, Count window) {
+    adviseWindow(grid, window, MADV_WILLNEED);
+}
+
+/**
+ * {@inheritDoc}
+ */
+void faultWindow(OutOfCoreGrid* grid, Count window) {
+    GridWindow* range     = &grid->windows[window];
+    Count       num_boxes = range->end - range->start;
+    Offset      num_nhbrs = range->last_nhbr - range->first_nhbr;
+
+    faultRange(&grid->perimeters[range->start], num_boxes * sizeof(Coord));
+    faultRange(&grid->num_nhbrs[range->start], num_boxes * sizeof(Count));
+    faultRange(&grid->offsets[range->start], num_boxes * sizeof(Offset));
+    faultRange(&grid->self_overlaps[range->start], num_boxes * sizeof(Coord));
+    faultRange(&grid->nhbr_ids[range->first_nhbr], num_nhbrs * sizeof(Count));
+    faultRange(&grid->overlaps[range->first_nhbr], num_nhbrs * sizeof(Coord));
+}
+
+/**
+ * {@inheritDoc}
+ */
+void releaseWindow(OutOfCoreGrid* grid, Count window) {
+    adviseWindow(grid, window, MADV_DONTNEED);
+}
+
+/**
+ * {@inheritDoc}
+ */
+void closeOutOfCoreGrid(OutOfCoreGrid* grid) {
+    closeInputBuffer(grid->source);
+    free(grid->windows);
+    free(grid->vals);
+    free(grid);
+}
@@ -0,0 +1,246 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+#include "patch.h"
+#include "reorder.h"
+
+/**
+ * Marks a missing link between boxes
+ */
+#define NO_BOX ((Count) -1)
+
+/**
+ * {@inheritDoc}
+ */
+int patchesEnabled() {
+    const char* enabled = getenv(PATCHES_ENV);
+    return (enabled != NULL) && (*enabled != '\0') && (strcmp(enabled, "0") != 0);
+}
+
+/**
+ * Box id keyed by its top-left corner
+ */
+typedef struct CornerId {
+    Coord y, x;
+    Count id;
+} CornerId;
+
+static int compareCorners(const void* a, const void* b) {
+    const CornerId* p = a;
+    const CornerId* q = b;
+    if (p->y != q->y) {
+        return (p->y < q->y) ? -1 : 1;
+    }
+    if (p->x != q->x) {
+        return (p->x < q->x) ? -1 : 1;
+    }
+    return (p->id < q->id) ? -1 : (p->id > q->id);
+}
+
+/**
+ * Whether two boxes have the same size
+ */
+static inline int sameSize(const BoxBounds* a, const BoxBounds* b) {
+    return (a->x_max - a->x_min == b->x_max - b->x_min)
+        && (a->y_max - a->y_min == b->y_max - b->y_min);
+}
+
+/**
+ * {@inheritDoc}
+ */
+PatchSet* buildPatches(AMRInput* input) {
+    Count            N      = input->N;
+    const BoxBounds* bounds = input->bounds;
+
+    /**
+     * Link each box to the box of the same size sharing its
+     * whole right (bottom) side, if there is one
+     */
+    Count* right = malloc(N * sizeof(*right));
+    Count* below = malloc(N * sizeof(*below));
+    for (Count i = 0; i < N; ++i) {
+        const BoxBounds* box      = &bounds[i];
+        const Count*     nhbr_ids = &input->nhbr_ids[input->offsets[i]];
+        right[i] = NO_BOX;
+        below[i] = NO_BOX;
+        for (Count nhbr = 0; nhbr < input->num_nhbrs[i]; ++nhbr) {
+            const BoxBounds* other = &bounds[nhbr_ids[nhbr]];
+            if (!sameSize(box, other)) {
+                continue;
+            }
+            if ((other->x_min == box->x_max) && (other->y_min == box->y_min)) {
+                right[i] = nhbr_ids[nhbr];
+            } else if ((other->y_min == box->y_max) && (other->x_min == box->x_min)) {
+                below[i] = nhbr_ids[nhbr];
+            }
+        }
+    }
+
+    /**
+     * Grow patches from the top-left-most free box: first along its row,
+     * then row by row while the whole next row lines up underneath
+     */
+    CornerId* corners = malloc(N * sizeof(*corners));
+    for (Count i = 0; i < N; ++i) {
+        corners[i] = (CornerId) { bounds[i].y_min, bounds[i].x_min, i };
+    }
+    qsort(corners, N, sizeof(*corners), compareCorners);
+
+    unsigned char* taken       = calloc(N, sizeof(*taken));
+    Count*         order       = arenaAlloc(input->arena, N * sizeof(*order));
+    Count*         row_ids     = malloc(N * sizeof(*row_ids));
+    Patch*         patches     = malloc(N / (PATCH_MIN_SIDE * PATCH_MIN_SIDE) * sizeof(*patches) + sizeof(*patches));
+    Count          num_patches = 0;
+    Count          placed      = 0;
+    for (Count s = 0; s < N; ++s) {
+        Count seed = corners[s].id;
+        if (taken[seed]) {
+            continue;
+        }
+        Count width = 0;
+        for (Count id = seed; (id != NO_BOX) && !taken[id]; id = right[id]) {
+            row_ids[width++] = id;
+        }
+        if (width < PATCH_MIN_SIDE) {
+            continue;
+        }
+
+        Count height = 1;
+        Count start  = placed;
+        for (Count c = 0; c < width; ++c) {
+            order[placed++] = row_ids[c];
+            taken[row_ids[c]] = 1;
+        }
+        for (;;) {
+            const Count* above = &order[placed - width];
+            Count        id    = below[above[0]];
+            Count        c;
+            for (c = 0; c < width; ++c) {
+                if ((id == NO_BOX) || taken[id] || (below[above[c]] != id)) {
+                    break;
+                }
+                row_ids[c] = id;
+                id = right[id];
+            }
+            if (c < width) {
+                break;
+            }
+            for (c = 0; c < width; ++c) {
+                order[placed++] = row_ids[c];
+                taken[row_ids[c]] = 1;
+            }
+            ++height;
+        }
+
+        if (height < PATCH_MIN_SIDE) {
+            for (Count p = start; p < placed; ++p) {
+                taken[order[p]] = 0;
+            }
+            placed = start;
+            continue;
+        }
+        patches[num_patches++] = (Patch) { start, width, height, 0, 0, 0, 0, 0 };
+    }
+
+    /**
+     * All other boxes follow in id order
+     */
+    Count first_rest = placed;
+    for (Count i = 0; i < N; ++i) {
+        if (!taken[i]) {
+            order[placed++] = i;
+        }
+    }
+    applyOrder(input, order);
+
+    /**
+     * Patch borders and the other boxes go through CSR
+     */
+    PatchSet* set    = arenaAlloc(input->arena, sizeof(*set));
+    set->num_patches = num_patches;
+    set->patches     = arenaAlloc(input->arena, num_patches * sizeof(*set->patches));
+    memcpy(set->patches, patches, num_patches * sizeof(*set->patches));
+    set->rows     = arenaAlloc(input->arena, N * sizeof(*set->rows));
+    set->num_rows = 0;
+    for (Count p = 0; p < num_patches; ++p) {
+        const Patch* patch = &set->patches[p];
+        for (Count r = 0; r < patch->height; ++r) {
+            for (Count c = 0; c < patch->width; ++c) {
+                if ((r == 0) || (c == 0) || (r == patch->height - 1) || (c == patch->width - 1)) {
+                    set->rows[set->num_rows++] = patch->base + r * patch->width + c;
+                }
+            }
+        }
+    }
+    for (Count i = first_rest; i < N; ++i) {
+        set->rows[set->num_rows++] = i;
+    }
+    arenaTrim(input->arena, set->rows, set->num_rows * sizeof(*set->rows));
+
+    free(patches);
+    free(row_ids);
+    free(taken);
+    free(corners);
+    free(below);
+    free(right);
+    return set;
+}
+
+/**
+ * {@inheritDoc}
+ */
+void setPatchWeights(PatchSet* patches, const AMRInput* input,
+                     const Weight* diag_weights, const Weight* nhbr_weights) {
+    for (Count p = 0; p < patches->num_patches; ++p) {
+        Patch*        patch    = &patches->patches[p];
+        Count         id       = patch->base + patch->width + 1;
+        const Count*  nhbr_ids = &input->nhbr_ids[input->offsets[id]];
+        const Weight* weights  = &nhbr_weights[input->offsets[id]];
+        patch->diag = diag_weights[id];
+        for (Count nhbr = 0; nhbr < input->num_nhbrs[id]; ++nhbr) {
+            if (nhbr_ids[nhbr] == id - patch->width) {
+                patch->up = weights[nhbr];
+            } else if (nhbr_ids[nhbr] == id + patch->width) {
+                patch->down = weights[nhbr];
+            } else if (nhbr_ids[nhbr] == id - 1) {
+                patch->left = weights[nhbr];
+            } else {
+                patch->right = weights[nhbr];
+            }
+        }
+    }
+}
+
+/**
+ * {@inheritDoc}
+ */
+void patchUpdate(const PatchSet* patches, const AMRInput* input, const Weight* diag_weights,
+                 const Weight* nhbr_weights, const DSV* vals, DSV* updated_vals) {
+    for (Count p = 0; p < patches->num_patches; ++p) {
+        const Patch* patch = &patches->patches[p];
+        Count        width = patch->width;
+        for (Count r = 1; r + 1 < patch->height; ++r) {
+            const DSV* above   = &vals[patch->base + (r - 1) * width];
+            const DSV* row     = &vals[patch->base + r * width];
+            const DSV* below   = &vals[patch->base + (r + 1) * width];
+            DSV*       updated = &updated_vals[patch->base + r * width];
+            for (Count c = 1; c + 1 < width; ++c) {
+                updated[c] = patch->diag * row[c]
+                           + patch->up * above[c] + patch->down * below[c]
+                           + patch->left * row[c - 1] + patch->right * row[c + 1];
+            }
+        }
+    }
+
+    for (Count k = 0; k < patches->num_rows; ++k) {
+        Count         i        = patches->rows[k];
+        const Count*  nhbr_ids = &input->nhbr_ids[input->offsets[i]];
+        const Weight* weights  = &nhbr_weights[input->offsets[i]];
+        DSV updated = diag_weights[i] * vals[i];
+        for (Count nhbr = 0; nhbr < input->num_nhbrs[i]; ++nhbr) {
+            updated += weights[nhbr] * vals[nhbr_ids[nhbr]];
+        }
+        updated_vals[i] = updated;
+    }
+}
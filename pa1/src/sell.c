@@ -0,0 +1,138 @@
+#include <stdlib.h>
+
+#include "arena.h"
+#include "sell.h"
+
+/**
+ * {@inheritDoc}
+ */
+Count sellSigma() {
+    const char* value = getenv(SELL_ENV);
+    if ((value == NULL) || (*value == '\0')) {
+        return 0;
+    }
+    long sigma = strtol(value, NULL, 10);
+    return (sigma < 1) ? 1 : sigma;
+}
+
+/**
+ * Box id paired with its neighbor count
+ */
+typedef struct SizedRow {
+    Count num_nhbrs;
+    Count id;
+} SizedRow;
+
+/**
+ * Most neighbors first, ties by id
+ */
+static int compareSizedRows(const void* a, const void* b) {
+    const SizedRow* x = a;
+    const SizedRow* y = b;
+    if (x->num_nhbrs != y->num_nhbrs) {
+        return (x->num_nhbrs > y->num_nhbrs) ? -1 : 1;
+    }
+    return (x->id < y->id) ? -1 : (x->id > y->id);
+}
+
+/**
+ * {@inheritDoc}
+ */
+SellGrid* buildSellGrid(const AMRInput* input, Count sigma, const Weight* diag_weights,
+                        const Weight* nhbr_weights, Arena* arena) {
+    SellGrid* sell   = arenaAlloc(arena, sizeof(*sell));
+    Count     N      = input->N;
+    Count     padded = (N + SELL_C - 1) / SELL_C * SELL_C;
+    sell->N          = N;
+    sell->sigma      = (sigma + SELL_C - 1) / SELL_C * SELL_C;
+    sell->num_slices = padded / SELL_C;
+
+    /**
+     * Sort rows by neighbor count within each window
+     */
+    SizedRow* sorted = malloc(N * sizeof(*sorted));
+    for (Count i = 0; i < N; ++i) {
+        sorted[i] = (SizedRow) { input->num_nhbrs[i], i };
+    }
+    for (Count start = 0; start < N; start += sell->sigma) {
+        Count count = (N - start < sell->sigma) ? N - start : sell->sigma;
+        qsort(&sorted[start], count, sizeof(*sorted), compareSizedRows);
+    }
+
+    sell->rows          = arenaAlloc(arena, padded * sizeof(*sell->rows));
+    sell->diag_weights  = arenaAlloc(arena, padded * sizeof(*sell->diag_weights));
+    sell->widths        = arenaAlloc(arena, sell->num_slices * sizeof(*sell->widths));
+    sell->slice_offsets = arenaAlloc(arena, (sell->num_slices + 1) * sizeof(*sell->slice_offsets));
+    Offset entries = 0;
+    for (Count s = 0; s < sell->num_slices; ++s) {
+        Count width = 0;
+        for (Count r = 0; r < SELL_C; ++r) {
+            Count slot = s * SELL_C + r;
+            if (slot < N) {
+                sell->rows[slot]         = sorted[slot].id;
+                sell->diag_weights[slot] = diag_weights[sorted[slot].id];
+                width = (sorted[slot].num_nhbrs > width) ? sorted[slot].num_nhbrs : width;
+            } else {
+                sell->rows[slot]         = 0;
+                sell->diag_weights[slot] = 0;
+            }
+        }
+        sell->widths[s]        = width;
+        sell->slice_offsets[s] = entries;
+        entries += (Offset) width * SELL_C;
+    }
+    sell->slice_offsets[sell->num_slices] = entries;
+    free(sorted);
+
+    /**
+     * Fill each slice column by column
+     */
+    sell->nhbr_ids = arenaAlloc(arena, entries * sizeof(*sell->nhbr_ids));
+    sell->weights  = arenaAlloc(arena, entries * sizeof(*sell->weights));
+    for (Count s = 0; s < sell->num_slices; ++s) {
+        Count*  slice_ids     = &sell->nhbr_ids[sell->slice_offsets[s]];
+        Weight* slice_weights = &sell->weights[sell->slice_offsets[s]];
+        for (Count r = 0; r < SELL_C; ++r) {
+            Count slot      = s * SELL_C + r;
+            Count id        = sell->rows[slot];
+            Count num_nhbrs = (slot < N) ? input->num_nhbrs[id] : 0;
+            for (Count k = 0; k < sell->widths[s]; ++k) {
+                if (k < num_nhbrs) {
+                    slice_ids[k * SELL_C + r]     = input->nhbr_ids[input->offsets[id] + k];
+                    slice_weights[k * SELL_C + r] = nhbr_weights[input->offsets[id] + k];
+                } else {
+                    slice_ids[k * SELL_C + r]     = id;
+                    slice_weights[k * SELL_C + r] = 0;
+                }
+            }
+        }
+    }
+    return sell;
+}
+
+/**
+ * {@inheritDoc}
+ */
+void sellUpdate(const SellGrid* sell, const DSV* vals, DSV* updated_vals) {
+    for (Count s = 0; s < sell->num_slices; ++s) {
+        const Count*  rows    = &sell->rows[s * SELL_C];
+        const Weight* diag    = &sell->diag_weights[s * SELL_C];
+        const Count*  ids     = &sell->nhbr_ids[sell->slice_offsets[s]];
+        const Weight* weights = &sell->weights[sell->slice_offsets[s]];
+
+        DSV sums[SELL_C];
+        for (Count r = 0; r < SELL_C; ++r) {
+            sums[r] = diag[r] * vals[rows[r]];
+        }
+        for (Count k = 0; k < sell->widths[s]; ++k) {
+            for (Count r = 0; r < SELL_C; ++r) {
+                sums[r] += weights[k * SELL_C + r] * vals[ids[k * SELL_C + r]];
+            }
+        }
+
+        Count count = (sell->N - s * SELL_C < SELL_C) ? sell->N - s * SELL_C : SELL_C;
+        for (Count r = 0; r < count; ++r) {
+            updated_vals[rows[r]] = sums[r];
+        }
+    }
+}
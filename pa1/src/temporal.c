@@ -0,0 +1,232 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+#include "temporal.h"
+
+/**
+ * Marks a box not (yet) in the current block
+ */
+#define NO_BOX ((Count) -1)
+
+/**
+ * {@inheritDoc}
+ */
+Count temporalSteps() {
+    const char* steps = getenv(TEMPORAL_ENV);
+    if ((steps == NULL) || (*steps == '\0')) {
+        return 0;
+    }
+    char*         end;
+    unsigned long value = strtoul(steps, &end, 10);
+    if ((*steps < '0') || (*steps > '9') || (*end != '\0') || (value > TEMPORAL_MAX_STEPS)) {
+        fprintf(stderr, "Error: unknown %s '%s' (expected 0 to %d)\n", TEMPORAL_ENV, steps, TEMPORAL_MAX_STEPS);
+        exit(1);
+    }
+    return value;
+}
+
+/**
+ * Bytes one box's row, weights and two DSVs take in a block
+ */
+static inline size_t boxBytes(const AMRInput* input, Count i) {
+    return sizeof(Offset) + sizeof(Count) + sizeof(Weight) + 2 * sizeof(DSV)
+         + input->num_nhbrs[i] * (sizeof(Count) + sizeof(Weight));
+}
+
+/**
+ * {@inheritDoc}
+ */
+TemporalGrid* buildTemporalGrid(const AMRInput* input, Count steps, const Weight* diag_weights,
+                                const Weight* nhbr_weights, struct Arena* arena) {
+    Count N = input->N;
+
+    /**
+     * Cut the ids into ranges of about half the block budget,
+     * leaving the other half to the ghost layers
+     */
+    Count* starts     = malloc((N + 1) * sizeof(*starts));
+    Count  num_blocks = 0;
+    size_t bytes      = 0;
+    starts[0] = 0;
+    for (Count i = 0; i < N; ++i) {
+        bytes += boxBytes(input, i);
+        if (bytes >= TEMPORAL_BLOCK_BYTES / 2) {
+            starts[++num_blocks] = i + 1;
+            bytes = 0;
+        }
+    }
+    if (starts[num_blocks] < N) {
+        starts[++num_blocks] = N;
+    }
+
+    TemporalGrid* grid = arenaAlloc(arena, sizeof(*grid));
+    grid->steps      = steps;
+    grid->num_blocks = num_blocks;
+    grid->blocks     = arenaAlloc(arena, num_blocks * sizeof(*grid->blocks));
+    grid->num_ghosts = 0;
+
+    Count* local_of  = malloc(N * sizeof(*local_of));
+    Count* local_ids = malloc(N * sizeof(*local_ids));
+    memset(local_of, 0xFF, N * sizeof(*local_of));
+    Count max_local = 0;
+    for (Count b = 0; b < num_blocks; ++b) {
+        TemporalBlock* block = &grid->blocks[b];
+        block->layer_ends    = arenaAlloc(arena, (steps + 1) * sizeof(*block->layer_ends));
+
+        /**
+         * Own boxes, then each layer's unseen neighbors
+         */
+        Count num_local = 0;
+        for (Count i = starts[b]; i < starts[b + 1]; ++i) {
+            local_of[i] = num_local;
+            local_ids[num_local++] = i;
+        }
+        block->layer_ends[0] = num_local;
+        for (Count d = 1; d <= steps; ++d) {
+            Count first = (d == 1) ? 0 : block->layer_ends[d - 2];
+            Count last  = block->layer_ends[d - 1];
+            for (Count j = first; j < last; ++j) {
+                Count        i        = local_ids[j];
+                const Count* nhbr_ids = &input->nhbr_ids[input->offsets[i]];
+                for (Count nhbr = 0; nhbr < input->num_nhbrs[i]; ++nhbr) {
+                    if (local_of[nhbr_ids[nhbr]] == NO_BOX) {
+                        local_of[nhbr_ids[nhbr]] = num_local;
+                        local_ids[num_local++]   = nhbr_ids[nhbr];
+                    }
+                }
+            }
+            block->layer_ends[d] = num_local;
+        }
+        block->num_local = num_local;
+        block->ids       = arenaAlloc(arena, num_local * sizeof(*block->ids));
+        memcpy(block->ids, local_ids, num_local * sizeof(*block->ids));
+        grid->num_ghosts += num_local - block->layer_ends[0];
+        max_local = (num_local > max_local) ? num_local : max_local;
+
+        /**
+         * Copy the rows of all but the outermost layer, in local ids
+         */
+        Count  num_rows    = block->layer_ends[steps - 1];
+        Offset total_nhbrs = 0;
+        for (Count j = 0; j < num_rows; ++j) {
+            total_nhbrs += input->num_nhbrs[local_ids[j]];
+        }
+        block->offsets      = arenaAlloc(arena, num_rows * sizeof(*block->offsets));
+        block->num_nhbrs    = arenaAlloc(arena, num_rows * sizeof(*block->num_nhbrs));
+        block->diag_weights = arenaAlloc(arena, num_rows * sizeof(*block->diag_weights));
+        block->nhbr_ids     = arenaAlloc(arena, total_nhbrs * sizeof(*block->nhbr_ids));
+        block->nhbr_weights = arenaAlloc(arena, total_nhbrs * sizeof(*block->nhbr_weights));
+        Offset offset = 0;
+        for (Count j = 0; j < num_rows; ++j) {
+            Count i = local_ids[j];
+            block->offsets[j]      = offset;
+            block->num_nhbrs[j]    = input->num_nhbrs[i];
+            block->diag_weights[j] = diag_weights[i];
+            for (Count nhbr = 0; nhbr < input->num_nhbrs[i]; ++nhbr) {
+                block->nhbr_ids[offset]     = local_of[input->nhbr_ids[input->offsets[i] + nhbr]];
+                block->nhbr_weights[offset] = nhbr_weights[input->offsets[i] + nhbr];
+                ++offset;
+            }
+        }
+
+        for (Count j = 0; j < num_local; ++j) {
+            local_of[local_ids[j]] = NO_BOX;
+        }
+    }
+
+    grid->vals         = arenaAlloc(arena, max_local * sizeof(*grid->vals));
+    grid->updated_vals = arenaAlloc(arena, max_local * sizeof(*grid->updated_vals));
+
+    free(local_ids);
+    free(local_of);
+    free(starts);
+    return grid;
+}
+
+/**
+ * {@inheritDoc}
+ */
+AMRMaxMin temporalSweep(const TemporalGrid* grid, const DSV* vals, DSV* updated_vals) {
+    AMRMaxMin range = { -HUGE_VAL, HUGE_VAL };
+    for (Count b = 0; b < grid->num_blocks; ++b) {
+        const TemporalBlock* block = &grid->blocks[b];
+        DSV* local_vals   = grid->vals;
+        DSV* local_update = grid->updated_vals;
+        for (Count j = 0; j < block->num_local; ++j) {
+            local_vals[j] = vals[block->ids[j]];
+        }
+
+        /**
+         * Each iteration, one layer fewer is still needed (and still correct)
+         */
+        for (Count step = 1; step <= grid->steps; ++step) {
+            Count num_rows = block->layer_ends[grid->steps - step];
+            for (Count j = 0; j < num_rows; ++j) {
+                const Count*  nhbr_ids = &block->nhbr_ids[block->offsets[j]];
+                const Weight* weights  = &block->nhbr_weights[block->offsets[j]];
+                DSV updated = block->diag_weights[j] * local_vals[j];
+                for (Count nhbr = 0; nhbr < block->num_nhbrs[j]; ++nhbr) {
+                    updated += weights[nhbr] * local_vals[nhbr_ids[nhbr]];
+                }
+                local_update[j] = updated;
+            }
+            DSV* temp    = local_vals;
+            local_vals   = local_update;
+            local_update = temp;
+        }
+
+        /**
+         * Own boxes have consecutive ids
+         */
+        DSV* own_vals = &updated_vals[block->ids[0]];
+        for (Count j = 0; j < block->layer_ends[0]; ++j) {
+            own_vals[j] = local_vals[j];
+            range.max = (local_vals[j] > range.max) ? local_vals[j] : range.max;
+            range.min = (local_vals[j] < range.min) ? local_vals[j] : range.min;
+        }
+    }
+    return range;
+}
+
+/**
+ * {@inheritDoc}
+ */
+unsigned long runTemporal(const TemporalGrid* grid, AMRInput* input, UpdateKernel kernel,
+                          const Weight* diag_weights, const Weight* nhbr_weights,
+                          float epsilon, AMRMaxMin* max_min, DSV** updated_vals) {
+    DSV*          vals      = input->vals;
+    DSV*          next_vals = *updated_vals;
+    AMRMaxMin     range     = *max_min;
+    unsigned long iter      = 0;
+    while ((range.max - range.min) / range.max > epsilon) {
+        AMRMaxMin swept = temporalSweep(grid, vals, next_vals);
+        if ((swept.max - swept.min) / swept.max > epsilon) {
+            DSV* temp = vals;
+            vals      = next_vals;
+            next_vals = temp;
+            range     = swept;
+            iter     += grid->steps;
+            continue;
+        }
+
+        /**
+         * Converged during the sweep: replay it from
+         * its start to find the iteration that did
+         */
+        do {
+            range = kernel(input, diag_weights, nhbr_weights, 0, input->N, vals, next_vals);
+            DSV* temp = vals;
+            vals      = next_vals;
+            next_vals = temp;
+            ++iter;
+        } while ((range.max - range.min) / range.max > epsilon);
+    }
+
+    input->vals   = vals;
+    *updated_vals = next_vals;
+    *max_min      = range;
+    return iter;
+}
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "common.h"
+#include "convergence.h"
+#include "simd.h"
 
 Count* starts;
 
@@ -13,17 +15,17 @@ void splitByNhbrs(AMRInput* input, Count num_threads) {
     /**
      * Track number of arithmetic ops (+, *, /)
      */
-    Count total = 0;
+    Offset total = 0;
     for (Count i = 0; i < input->N; ++i) {
-        total += 2 + 2 * input->boxes[i].num_nhbrs + 4;
+        total += 2 + 2 * input->num_nhbrs[i] + 4;
     }
 
-    starts[0]         = 0;
-    Count curr_id     = 0;
-    Count curr_total  = 0;
-    Count curr_target = total / num_threads;
+    starts[0]          = 0;
+    Count  curr_id     = 0;
+    Offset curr_total  = 0;
+    Offset curr_target = total / num_threads;
     for (Count i = 0; i < input->N - 1; ++i) {
-        curr_total += 2 + 2 * input->boxes[i].num_nhbrs + 4;
+        curr_total += 2 + 2 * input->num_nhbrs[i] + 4;
         if (curr_total >= curr_target) {
             total      -= curr_total;
             curr_target = total / (num_threads - curr_id - 1);
@@ -55,9 +57,20 @@ typedef struct WorkerData {
     DSV*      vals;
     DSV*      updated_vals;
 
+    const Weight* diag_weights;
+    const Weight* nhbr_weights;
+    UpdateKernel  kernel;
+
     AMRMaxMin* max_min;
     DSV*       priv_max;
     DSV*       priv_min;
+
+    /**
+     * Persistent threads only: the check schedule and
+     * the iteration count after each check (both thread 0's)
+     */
+    ConvergenceCheck* check;
+    unsigned long*    iterations;
 } WorkerData;
 /**
  * Code run by each thread during single iteration.
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "common.h"
+#include "reader.h"
+
+/**
+ * Compiled binary grid format (.amrb)
+ *
+ * The file starts with an {@code AMRBHeader}, followed by the
+ * final CSR arrays, each starting on an {@code AMRB_ALIGNMENT}-byte
+ * boundary so they can be used in place once the file is mapped:
+ *
+ * {@code perimeters}    - N Coords
+ * {@code num_nhbrs}     - N Counts
+ * {@code offsets}       - N Offsets
+ * {@code self_overlaps} - N Coords
+ * {@code nhbr_ids}      - total_nhbrs Counts
+ * {@code overlaps}      - total_nhbrs Coords
+ * {@code bounds}        - N BoxBounds
+ * {@code vals}          - N DSVs (initial values)
+ *
+ * Files are only valid for builds with the same
+ * {@code Count}/{@code Offset}/{@code Coord}/{@code DSV} sizes and byte order.
+ */
+#define AMRB_MAGIC     "AMRB"
+#define AMRB_VERSION   3
+#define AMRB_ALIGNMENT 64
+
+typedef enum {
+    AMRB_PERIMETERS=0,
+    AMRB_NUM_NHBRS,
+    AMRB_OFFSETS,
+    AMRB_SELF_OVERLAPS,
+    AMRB_NHBR_IDS,
+    AMRB_OVERLAPS,
+    AMRB_BOUNDS,
+    AMRB_VALS,
+    AMRB_NUM_SECTIONS
+} AMRBSection;
+
+typedef struct AMRBHeader {
+    char     magic[4];
+    uint32_t version;
+    uint32_t count_bytes;
+    uint32_t coord_bytes;
+    uint32_t dsv_bytes;
+    uint32_t num_sections;
+    uint32_t offset_bytes;
+    uint32_t reserved;
+
+    uint64_t N;
+    uint64_t rows;
+    uint64_t cols;
+    uint64_t total_nhbrs;
+
+    /**
+     * Byte offset (from the start of the file) and
+     * length of each {@code AMRBSection}
+     */
+    uint64_t section_offsets[AMRB_NUM_SECTIONS];
+    uint64_t section_bytes[AMRB_NUM_SECTIONS];
+} AMRBHeader;
+
+/**
+ * Checks whether the given input holds a compiled binary grid.
+ *
+ * Compressed input never counts, compiled grids are only used in place.
+ *
+ * @param buffer opened {@code InputBuffer}
+ * @return non-zero if the input starts with {@code AMRB_MAGIC}
+ */
+int isBinaryInput(const InputBuffer* buffer);
+
+/**
+ * Checks that the header of a compiled binary grid matches this build
+ * and that all of its sections lie within the input.
+ * Exits with an error message otherwise.
+ *
+ * @param buffer opened {@code InputBuffer} holding a binary grid
+ * @return the header, in place at the start of {@code buffer}
+ */
+const AMRBHeader* checkBinaryHeader(const InputBuffer* buffer);
+
+/**
+ * Checks the topology of a compiled binary grid in one pass, since the
+ * solvers index with it unchecked: rows in order and within
+ * {@code total_nhbrs} (the last one ending there), neighbor ids below
+ * {@code N} and perimeters nonzero. Exits with an error message otherwise.
+ *
+ * @param header header returned by {@code checkBinaryHeader()}
+ * @param data   start of the binary grid
+ */
+void checkBinaryData(const AMRBHeader* header, const char* data);
+
+/**
+ * Builds an {@code AMRInput} from a compiled binary grid.
+ * The topology arrays point directly into {@code buffer},
+ * which is owned by the returned input from then on and
+ * released by {@code destroyInput()}. Only the DSVs are copied.
+ *
+ * @param buffer opened {@code InputBuffer} holding a binary grid
+ * @return the allocated/populated {@code AMRInput} struct
+ */
+AMRInput* loadBinaryInput(InputBuffer* buffer);
+
+/**
+ * Writes the given input as a compiled binary grid.
+ *
+ * @param input     pointer to populated {@code AMRInput} struct
+ * @param file_name path of the output file
+ */
+void writeBinaryInput(AMRInput* input, const char* file_name);
+
+/**
+ * Writes the given input as a compiled binary grid
+ * to an already opened stream.
+ *
+ * @param input pointer to populated {@code AMRInput} struct
+ * @param file  stream opened for writing, positioned at the start
+ */
+void writeBinaryStream(AMRInput* input, FILE* file);
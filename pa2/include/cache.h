@@ -0,0 +1,79 @@
+#pragma once
+
+#include <limits.h>
+#include <stdint.h>
+
+#include "common.h"
+#include "reader.h"
+
+/**
+ * Environment variable naming the parse cache directory
+ * (caching is disabled when it is not set)
+ */
+#define CACHE_DIR_ENV "AMR_CACHE_DIR"
+
+/**
+ * Key of a text grid in the parse cache.
+ *
+ * Cached grids are compiled binary grids named after the
+ * content hash and size of the text they were parsed from
+ * (and the {@code Count}/{@code Coord}/{@code DSV} sizes of the build).
+ * Next to them, a small stamp per input file (by device and inode)
+ * remembers the size, mtime and content hash last seen, so unchanged
+ * files are not re-hashed. Any change of size or mtime re-hashes the
+ * file, and new content maps to a new entry.
+ *
+ * {@code size}         - size of the text grid in bytes
+ * {@code mtime_*}      - modification time of the text grid
+ * {@code content_hash} - hash of the text grid
+ * {@code stamp_path}   - path of the stamp file, empty for pipes
+ * {@code entry_path}   - path of the cached binary grid
+ */
+typedef struct CacheKey {
+    uint64_t size;
+    int64_t  mtime_sec;
+    int64_t  mtime_nsec;
+    uint64_t content_hash;
+    char     stamp_path[PATH_MAX];
+    char     entry_path[PATH_MAX];
+} CacheKey;
+
+/**
+ * 64-bit (non-cryptographic) hash of raw input bytes,
+ * used to key cached and shared grids.
+ *
+ * @param data first byte to hash
+ * @param size number of bytes to hash
+ * @return the hash
+ */
+uint64_t hashBytes(const char* data, size_t size);
+
+/**
+ * Computes the cache key of a text grid, if caching is enabled.
+ * Streamed (compressed) input is never cached, as it is not all in memory to hash.
+ *
+ * @param file_name path of the grid, or {@code NULL} for stdin
+ * @param buffer    opened {@code InputBuffer} holding the grid
+ * @param key       key to fill in
+ * @return non-zero if caching is enabled and {@code key} was filled in
+ */
+int initCacheKey(const char* file_name, const InputBuffer* buffer, CacheKey* key);
+
+/**
+ * Loads a text grid from the parse cache.
+ *
+ * @param key key from {@code initCacheKey()}
+ * @return the loaded {@code AMRInput}, or {@code NULL} if not cached
+ */
+AMRInput* loadCachedInput(const CacheKey* key);
+
+/**
+ * Stores a parsed text grid in the parse cache.
+ * Entries are written to a temporary file and renamed into place,
+ * so concurrent runs never see partial entries.
+ * Failures only produce a warning, the cache is never required.
+ *
+ * @param key   key from {@code initCacheKey()}
+ * @param input pointer to the populated {@code AMRInput} struct
+ */
+void storeCachedInput(const CacheKey* key, AMRInput* input);
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "common.h"
+
+/**
+ * Environment variable deferring convergence checks (any value but 0),
+ * unset to check after every iteration
+ */
+#define DEFERRED_ENV "AMR_DEFERRED"
+
+/**
+ * Most iterations between two deferred checks
+ */
+#define DEFERRED_MAX_INTERVAL 256
+
+/**
+ * Schedule of convergence checks. Deferred checks are spaced by half the
+ * iterations the gap's observed rate of decrease predicts are left, and keep
+ * the DSVs of the last check that did not converge; a check that converges
+ * more than one iteration after it rolls back to those DSVs and checks every
+ * iteration from there, so the iterations, max and min reported are exactly
+ * those of checking every iteration. That relies on the gap never growing,
+ * which holds for affect rates from 0 to 1 (the weights of each box are
+ * then a convex combination); with any other rate every iteration is checked:
+ *
+ * {@code deferred}   - whether checks are deferred
+ * {@code replaying}  - whether a rollback is being replayed
+ * {@code next_check} - iteration of the next check
+ * {@code last_check} - iteration of the kept DSVs
+ * {@code last_gap}   - gap, {@code (max - min) / max}, at the last check
+ * {@code snapshot}   - the kept DSVs
+ * {@code checks}, {@code rollbacks} - counts over the run
+ */
+typedef struct ConvergenceCheck {
+    int           deferred;
+    int           replaying;
+    unsigned long next_check;
+    unsigned long last_check;
+    double        last_gap;
+    DSV*          snapshot;
+    unsigned long checks;
+    unsigned long rollbacks;
+} ConvergenceCheck;
+
+/**
+ * Reads whether checks are deferred from {@code DEFERRED_ENV}
+ */
+int deferredEnabled();
+
+/**
+ * Sets up the schedule, checking after the first iteration
+ *
+ * @param check       schedule to set up
+ * @param input       pointer to populated {@code AMRInput} struct, with the initial DSVs
+ * @param affect_rate affect rate of the run, checks are only deferred from 0 to 1
+ * @param max_min     extremal initial DSVs
+ */
+void initConvergenceCheck(ConvergenceCheck* check, const AMRInput* input, float affect_rate,
+                          AMRMaxMin max_min);
+
+/**
+ * Whether the DSVs after {@code iter} iterations are to be checked
+ */
+static inline int checkDue(const ConvergenceCheck* check, unsigned long iter) {
+    return iter >= check->next_check;
+}
+
+/**
+ * Checks the DSVs after {@code *iter} iterations and schedules the next check,
+ * rolling {@code vals} and {@code *iter} back to the last check if it was
+ * more than one iteration ago and the DSVs converged since
+ *
+ * @param check   schedule set up by {@code initConvergenceCheck()}
+ * @param N       number of boxes
+ * @param vals    current DSVs
+ * @param max_min their extremal values
+ * @param epsilon convergence cutoff
+ * @param iter    iterations run
+ * @return 0 once converged at {@code *iter}, 1 to keep iterating
+ */
+int finishCheck(ConvergenceCheck* check, Count N, DSV* vals, AMRMaxMin max_min,
+                float epsilon, unsigned long* iter);
+
+/**
+ * Frees the kept DSVs
+ */
+void destroyConvergenceCheck(ConvergenceCheck* check);
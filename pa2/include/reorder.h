@@ -0,0 +1,82 @@
+#pragma once
+
+#include "common.h"
+
+/**
+ * Environment variable selecting a box ordering applied to every
+ * grid loaded with {@code parseInput()}: {@code hilbert}, {@code rcm},
+ * or unset/empty/{@code none} to keep the ids as stored
+ */
+#define REORDER_ENV "AMR_REORDER"
+
+typedef enum { REORDER_NONE=0, REORDER_HILBERT, REORDER_RCM } ReorderKind;
+
+/**
+ * Spread of the neighbor ids of a grid:
+ *
+ * {@code bandwidth} - largest |i - j| over all neighbor entries (i, j)
+ * {@code profile}   - sum over boxes i of i minus its lowest neighbor id
+ *                     (0 for boxes with no lower neighbor)
+ */
+typedef struct GridProfile {
+    Count              bandwidth;
+    unsigned long long profile;
+} GridProfile;
+
+/**
+ * Reads the ordering named by {@code REORDER_ENV}.
+ * Exits with an error message on an unknown name.
+ *
+ * @return the ordering, {@code REORDER_NONE} if none is set
+ */
+ReorderKind reorderKind();
+
+/**
+ * Name of an ordering, as accepted in {@code REORDER_ENV}
+ */
+const char* reorderName(ReorderKind kind);
+
+/**
+ * Computes the bandwidth and profile of a grid
+ *
+ * @param input pointer to populated {@code AMRInput} struct
+ * @return the bandwidth and profile
+ */
+GridProfile measureProfile(const AMRInput* input);
+
+/**
+ * Computes a new box order for a grid:
+ *
+ * {@code REORDER_HILBERT} - boxes sorted by the Hilbert curve index of their
+ *                           centroids (ties by id)
+ * {@code REORDER_RCM}     - reverse Cuthill-McKee over the neighbor graph,
+ *                           each component started from a pseudo-peripheral
+ *                           box of lowest neighbor count
+ *
+ * @param input pointer to populated {@code AMRInput} struct
+ * @param kind  ordering to compute (not {@code REORDER_NONE})
+ * @param arena arena the order is allocated from
+ * @return {@code N} ids, the current id of the box that becomes box i
+ */
+Count* computeOrder(const AMRInput* input, ReorderKind kind, struct Arena* arena);
+
+/**
+ * Renumbers a grid in place to the given order.
+ * The CSR arrays, extents and DSVs are re-packed into new arrays in the
+ * input's arena (so a mapped compiled grid is never written), and
+ * {@code input->order} is updated to map the new ids to the ids as loaded.
+ *
+ * @param input pointer to populated {@code AMRInput} struct
+ * @param order order returned by {@code computeOrder()}
+ */
+void applyOrder(AMRInput* input, const Count* order);
+
+/**
+ * Copies DSVs back into the order the grid was loaded in
+ * (a plain copy if the grid was not reordered)
+ *
+ * @param input         pointer to populated {@code AMRInput} struct
+ * @param vals          {@code N} DSVs in the current order
+ * @param original_vals room for {@code N} DSVs
+ */
+void restoreOrder(const AMRInput* input, const DSV* vals, DSV* original_vals);
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "common.h"
+
+/**
+ * Environment variable capping the update kernel picked at startup
+ * ({@code scalar}, {@code avx2} or {@code avx512}),
+ * unset for the widest one the CPU supports
+ */
+#define SIMD_ENV "AMR_SIMD"
+
+/**
+ * Instruction sets of the update kernels, narrowest first
+ */
+typedef enum SimdKind {
+    SIMD_SCALAR,
+    SIMD_AVX2,
+    SIMD_AVX512
+} SimdKind;
+
+/**
+ * Computes the updated DSVs of boxes {@code start} to {@code end} (exclusive)
+ * from the weights (see {@code computeWeightRange()}), summing each box's
+ * terms in row order so every kernel gives the same DSVs, and tracks
+ * their extremal values on the way (no second pass over the DSVs)
+ *
+ * @param input        pointer to populated {@code AMRInput} struct
+ * @param diag_weights {@code N} diagonal weights
+ * @param nhbr_weights {@code total_nhbrs} neighbor weights
+ * @param start        first box to update
+ * @param end          one past the last box to update
+ * @param vals         current DSVs
+ * @param updated_vals room for {@code N} DSVs
+ * @return maximum and minimum updated DSV of the range
+ */
+typedef AMRMaxMin (*UpdateKernel)(const AMRInput* input, const Weight* diag_weights, const Weight* nhbr_weights,
+                                  Count start, Count end, const DSV* vals, DSV* updated_vals);
+
+/**
+ * Finds the widest kernel this CPU (and OS) supports, via cpuid
+ */
+SimdKind simdSupported();
+
+/**
+ * Reads the kernel to use: the widest supported, capped by {@code SIMD_ENV}
+ *
+ * @return the kernel's instruction set, exits on an unknown name
+ */
+SimdKind simdKind();
+
+/**
+ * Name of an instruction set, as read from {@code SIMD_ENV}
+ */
+const char* simdName(SimdKind kind);
+
+/**
+ * Looks up the update kernel of an instruction set
+ *
+ * @param kind instruction set, at most {@code simdSupported()}
+ * @return the kernel
+ */
+UpdateKernel updateKernel(SimdKind kind);
@@ -0,0 +1,211 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "amrb.h"
+#include "arena.h"
+
+const char* invalid_binary = "Error: invalid or incompatible binary grid\n";
+
+/**
+ * Rounds {@code bytes} up to the next multiple of {@code AMRB_ALIGNMENT}
+ */
+static inline uint64_t alignUp(uint64_t bytes) {
+    return (bytes + AMRB_ALIGNMENT - 1) & ~((uint64_t) AMRB_ALIGNMENT - 1);
+}
+
+/**
+ * Fills in the fixed part of a header and lays out the sections
+ */
+static void initHeader(AMRBHeader* header, Count N, Coord rows, Coord cols, Offset total_nhbrs) {
+    memset(header, 0, sizeof(*header));
+    memcpy(header->magic, AMRB_MAGIC, sizeof(header->magic));
+    header->version      = AMRB_VERSION;
+    header->count_bytes  = sizeof(Count);
+    header->offset_bytes = sizeof(Offset);
+    header->coord_bytes  = sizeof(Coord);
+    header->dsv_bytes    = sizeof(DSV);
+    header->num_sections = AMRB_NUM_SECTIONS;
+    header->N            = N;
+    header->rows         = rows;
+    header->cols         = cols;
+    header->total_nhbrs  = total_nhbrs;
+
+    header->section_bytes[AMRB_PERIMETERS]    = N * sizeof(Coord);
+    header->section_bytes[AMRB_NUM_NHBRS]     = N * sizeof(Count);
+    header->section_bytes[AMRB_OFFSETS]       = N * sizeof(Offset);
+    header->section_bytes[AMRB_SELF_OVERLAPS] = N * sizeof(Coord);
+    header->section_bytes[AMRB_NHBR_IDS]      = total_nhbrs * sizeof(Count);
+    header->section_bytes[AMRB_OVERLAPS]      = total_nhbrs * sizeof(Coord);
+    header->section_bytes[AMRB_BOUNDS]        = N * sizeof(BoxBounds);
+    header->section_bytes[AMRB_VALS]          = N * sizeof(DSV);
+
+    uint64_t offset = alignUp(sizeof(*header));
+    for (int section = 0; section < AMRB_NUM_SECTIONS; ++section) {
+        header->section_offsets[section] = offset;
+        offset = alignUp(offset + header->section_bytes[section]);
+    }
+}
+
+/**
+ * {@inheritDoc}
+ */
+const AMRBHeader* checkBinaryHeader(const InputBuffer* buffer) {
+    const AMRBHeader* header = (const AMRBHeader*) buffer->data;
+    if ((buffer->size < sizeof(*header))
+        || (memcmp(header->magic, AMRB_MAGIC, sizeof(header->magic)) != 0)
+        || (header->version != AMRB_VERSION)
+        || (header->count_bytes != sizeof(Count))
+        || (header->offset_bytes != sizeof(Offset))
+        || (header->coord_bytes != sizeof(Coord))
+        || (header->dsv_bytes != sizeof(DSV))
+        || (header->num_sections != AMRB_NUM_SECTIONS)
+        || (header->N > (Count) -1)
+        || (header->rows > (Coord) -1)
+        || (header->cols > (Coord) -1)
+        || (header->total_nhbrs > (Offset) -1)
+        || (header->total_nhbrs > UINT64_MAX / 2 / (sizeof(Count) + sizeof(Coord)))
+    ) {
+        fprintf(stderr, "%s", invalid_binary);
+        exit(1);
+    }
+
+    AMRBHeader expected;
+    initHeader(&expected, header->N, header->rows, header->cols, header->total_nhbrs);
+    for (int section = 0; section < AMRB_NUM_SECTIONS; ++section) {
+        if ((header->section_offsets[section] != expected.section_offsets[section])
+            || (header->section_bytes[section] != expected.section_bytes[section])
+            || (header->section_offsets[section] + header->section_bytes[section] > buffer->size)
+        ) {
+            fprintf(stderr, "%s", invalid_binary);
+            exit(1);
+        }
+    }
+    return header;
+}
+
+/**
+ * {@inheritDoc}
+ */
+void checkBinaryData(const AMRBHeader* header, const char* data) {
+    const Coord*  perimeters = (const Coord*) (data + header->section_offsets[AMRB_PERIMETERS]);
+    const Count*  num_nhbrs  = (const Count*) (data + header->section_offsets[AMRB_NUM_NHBRS]);
+    const Offset* offsets    = (const Offset*) (data + header->section_offsets[AMRB_OFFSETS]);
+    const Count*  nhbr_ids   = (const Count*) (data + header->section_offsets[AMRB_NHBR_IDS]);
+
+    uint64_t row_end = 0;
+    for (uint64_t i = 0; i < header->N; ++i) {
+        if ((perimeters[i] == 0) || (offsets[i] < row_end)) {
+            fprintf(stderr, "%s", invalid_binary);
+            exit(1);
+        }
+        row_end = (uint64_t) offsets[i] + num_nhbrs[i];
+        if (row_end > header->total_nhbrs) {
+            fprintf(stderr, "%s", invalid_binary);
+            exit(1);
+        }
+        for (uint64_t k = offsets[i]; k < row_end; ++k) {
+            if (nhbr_ids[k] >= header->N) {
+                fprintf(stderr, "%s", invalid_binary);
+                exit(1);
+            }
+        }
+    }
+    if (row_end != header->total_nhbrs) {
+        fprintf(stderr, "%s", invalid_binary);
+        exit(1);
+    }
+}
+
+/**
+ * Writes {@code bytes} from {@code data}, then pads to {@code AMRB_ALIGNMENT}
+ */
+static void writeSection(FILE* file, const void* data, uint64_t bytes) {
+    static const char padding[AMRB_ALIGNMENT] = { 0 };
+    if ((bytes > 0) && (fwrite(data, 1, bytes, file) != bytes)) {
+        perror("fwrite");
+        exit(1);
+    }
+    uint64_t extra = alignUp(bytes) - bytes;
+    if ((extra > 0) && (fwrite(padding, 1, extra, file) != extra)) {
+        perror("fwrite");
+        exit(1);
+    }
+}
+
+/**
+ * {@inheritDoc}
+ */
+int isBinaryInput(const InputBuffer* buffer) {
+    return (buffer->stream == NULL)
+        && (buffer->size >= sizeof(AMRBHeader))
+        && (memcmp(buffer->data, AMRB_MAGIC, strlen(AMRB_MAGIC)) == 0);
+}
+
+/**
+ * {@inheritDoc}
+ */
+AMRInput* loadBinaryInput(InputBuffer* buffer) {
+    const AMRBHeader* header = checkBinaryHeader(buffer);
+    const char*       data   = buffer->data;
+    checkBinaryData(header, data);
+
+    Arena*    arena = createArena(ARENA_BLOCK_SIZE);
+    AMRInput* input = arenaAlloc(arena, sizeof(*input));
+    input->arena  = arena;
+    input->N      = header->N;
+    input->rows   = header->rows;
+    input->cols   = header->cols;
+    input->source = buffer;
+
+    input->total_nhbrs   = header->total_nhbrs;
+    input->perimeters    = (Coord*) (data + header->section_offsets[AMRB_PERIMETERS]);
+    input->num_nhbrs     = (Count*) (data + header->section_offsets[AMRB_NUM_NHBRS]);
+    input->offsets       = (Offset*) (data + header->section_offsets[AMRB_OFFSETS]);
+    input->self_overlaps = (Coord*) (data + header->section_offsets[AMRB_SELF_OVERLAPS]);
+    input->nhbr_ids      = (Count*) (data + header->section_offsets[AMRB_NHBR_IDS]);
+    input->overlaps      = (Coord*) (data + header->section_offsets[AMRB_OVERLAPS]);
+
+    input->bounds = (BoxBounds*) (data + header->section_offsets[AMRB_BOUNDS]);
+
+    /**
+     * DSVs are updated during the run, so they get a private copy
+     */
+    input->vals = arenaAlloc(arena, input->N * sizeof(*input->vals));
+    memcpy(input->vals, data + header->section_offsets[AMRB_VALS], header->section_bytes[AMRB_VALS]);
+
+    return input;
+}
+
+/**
+ * {@inheritDoc}
+ */
+void writeBinaryInput(AMRInput* input, const char* file_name) {
+    FILE* file = fopen(file_name, "wb");
+    if (file == NULL) {
+        perror(file_name);
+        exit(1);
+    }
+    writeBinaryStream(input, file);
+    if (fclose(file) != 0) {
+        perror(file_name);
+        exit(1);
+    }
+}
+
+/**
+ * {@inheritDoc}
+ */
+void writeBinaryStream(AMRInput* input, FILE* file) {
+    AMRBHeader header;
+    initHeader(&header, input->N, input->rows, input->cols, input->total_nhbrs);
+    const void* sections[AMRB_NUM_SECTIONS] = {
+        input->perimeters, input->num_nhbrs, input->offsets, input->self_overlaps,
+        input->nhbr_ids, input->overlaps, input->bounds, input->vals
+    };
+
+    writeSection(file, &header, sizeof(header));
+    for (int section = 0; section < AMRB_NUM_SECTIONS; ++section) {
+        writeSection(file, sections[section], header.section_bytes[section]);
+    }
+}
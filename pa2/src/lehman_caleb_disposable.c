@@ -1,25 +1,30 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 #include <pthread.h>
 
 #include "amr.h"
+#include "arena.h"
 #include "common.h"
+#include "simd.h"
 
 const char* usage = "\
-Usage: disposable [affect-rate] [epsilon] [num-threads]\n\
+Usage: disposable [affect-rate] [epsilon] [num-threads] [test-file | --stdin]\n\
 \n\
 affect-rate: float value controlling the effect of neighboring boxes\n\
 epislon    : float value determining the cutoff for convergence\n\
              should be non-negative\n\
 num-threads: number of threads to spawn for computation\n\
-             should be positive\n";
+             should be positive\n\
+test-file  : test file with input to AMR problem, memory-mapped\n\
+--stdin    : read input from stdin instead (the default when omitted)\n";
 
 int main(int argc, char** argv) {
     /**
      * Parse command-line arguments
      */
-    if (argc != 4) {
+    if ((argc != 4) && (argc != 5)) {
         printf("%s", usage);
         exit(1);
     }
@@ -32,10 +37,15 @@ int main(int argc, char** argv) {
         exit(1);
     }
 
+    const char* test_file = NULL;
+    if ((argc == 5) && (strcmp(argv[4], "--stdin") != 0)) {
+        test_file = argv[4];
+    }
+
     /**
-     * Parse input data from standard input
+     * Parse input data from test file (or standard input)
      */
-    AMRInput* input = parseInput();
+    AMRInput* input = parseInput(test_file, num_threads);
 
     /**
      * Run and collect timing information
@@ -88,16 +98,23 @@ AMROutput run(AMRInput* input, float affect_rate, float epsilon, Count num_threa
     AMRMaxMin max_min = getMaxMin(input);
     DSV* maxs         = malloc(num_threads * sizeof(*maxs));
     DSV* mins         = malloc(num_threads * sizeof(*mins));
-    DSV* updated_vals = malloc(input->N * sizeof(*updated_vals));
+    DSV* updated_vals = arenaAlloc(input->arena, input->N * sizeof(*updated_vals));
     starts = malloc((num_threads + 1) * sizeof(*starts));
     splitByNhbrs(input, num_threads);
 
+    /**
+     * Fold the coefficients that stay constant for the run into weights
+     */
+    Weight* diag_weights = arenaAlloc(input->arena, input->N * sizeof(*diag_weights));
+    Weight* nhbr_weights = arenaAlloc(input->arena, input->total_nhbrs * sizeof(*nhbr_weights));
+    computeWeightRange(input, affect_rate, 0, input->N, diag_weights, nhbr_weights);
+    UpdateKernel kernel = updateKernel(simdKind());
+
     /**
      * updated_vals and input->vals are swapped during
-     * execution, need to remember originals for clean up
+     * execution, need to remember the original DSVs
      */
-    DSV* orig_vals         = input->vals;
-    DSV* orig_updated_vals = updated_vals;
+    DSV* orig_vals = input->vals;
 
     WorkerData* data_structs = malloc(num_threads * sizeof(*data_structs));
     pthread_t*  threads      = malloc(num_threads * sizeof(*threads));
@@ -114,6 +131,9 @@ AMROutput run(AMRInput* input, float affect_rate, float epsilon, Count num_threa
             data_structs[tid].num_threads  = num_threads;
             data_structs[tid].vals         = input->vals;
             data_structs[tid].updated_vals = updated_vals;
+            data_structs[tid].diag_weights = diag_weights;
+            data_structs[tid].nhbr_weights = nhbr_weights;
+            data_structs[tid].kernel       = kernel;
             data_structs[tid].max_min      = &max_min;
             data_structs[tid].priv_max     = &maxs[tid];
             data_structs[tid].priv_min     = &mins[tid];
@@ -142,19 +162,21 @@ AMROutput run(AMRInput* input, float affect_rate, float epsilon, Count num_threa
     }
 
     input->vals = orig_vals;
-    free(orig_updated_vals);
     free(maxs);
     free(mins);
     free(data_structs);
     free(threads);
     free(starts);
 
-    AMROutput result;
+    AMROutput result = { 0 };
     result.affect_rate = affect_rate;
     result.epsilon     = epsilon;
     result.iterations  = iter;
     result.max         = max_min.max;
     result.min         = max_min.min;
+    result.parse_bytes   = input->parse_bytes;
+    result.parse_seconds   = input->parse_seconds;
+    result.overlap_seconds = input->overlap_seconds;
     return result;
 }
 
@@ -165,38 +187,17 @@ void* worker(void* data) {
     Count start     = starts[tid];
     Count end       = starts[tid+1];
 
-    float affect_rate  = worker_data->affect_rate;
     DSV*  updated_vals = worker_data->updated_vals;
 
+    const Weight* diag_weights = worker_data->diag_weights;
+    const Weight* nhbr_weights = worker_data->nhbr_weights;
+
     /**
      * For each box handled by this thread
      */
-    DSV priv_max = worker_data->max_min->min;
-    DSV priv_min = worker_data->max_min->max;
-    for (Count i = start; i < end; ++i) {
-        BoxData* box = &input->boxes[i];
-        /**
-         * Compute updated DSV
-         */
-        updated_vals[i] = box->self_overlap * input->vals[i];
-        for (Count nhbr = 0; nhbr < box->num_nhbrs; ++nhbr) {
-            updated_vals[i] += box->overlaps[nhbr] * input->vals[box->nhbr_ids[nhbr]];
-        }
-        updated_vals[i] /= box->perimeter;
-        updated_vals[i] = input->vals[i] * (1 - affect_rate)
-            + updated_vals[i] * affect_rate;
-
-        /**
-         * Update extremal values
-         */
-        if (updated_vals[i] > priv_max) {
-            priv_max = updated_vals[i];
-        } else if (updated_vals[i] < priv_min) {
-            priv_min = updated_vals[i];
-        }
-    }
-    *(worker_data->priv_max) = priv_max;
-    *(worker_data->priv_min) = priv_min;
+    AMRMaxMin range = worker_data->kernel(input, diag_weights, nhbr_weights, start, end, input->vals, updated_vals);
+    *(worker_data->priv_max) = range.max;
+    *(worker_data->priv_min) = range.min;
 
     pthread_exit(NULL);
     return NULL;
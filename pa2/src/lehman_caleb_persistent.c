@@ -1,19 +1,24 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 #include <pthread.h>
 
 #include "amr.h"
+#include "arena.h"
 #include "common.h"
+#include "simd.h"
 
 const char* usage = "\
-Usage: amr [affect-rate] [epsilon] [num-threads]\n\
+Usage: amr [affect-rate] [epsilon] [num-threads] [test-file | --stdin]\n\
 \n\
 affect-rate: float value controlling the effect of neighboring boxes\n\
 epislon    : float value determining the cutoff for convergence\n\
              should be non-negative\n\
 num-threads: number of threads to spawn for computation\n\
-             should be positive\n";
+             should be positive\n\
+test-file  : test file with input to AMR problem, memory-mapped\n\
+--stdin    : read input from stdin instead (the default when omitted)\n";
 pthread_barrier_t barrier;
 
 /**
@@ -26,7 +31,7 @@ int main(int argc, char** argv) {
     /**
      * Parse command-line arguments
      */
-    if (argc != 4) {
+    if ((argc != 4) && (argc != 5)) {
         printf("%s", usage);
         exit(1);
     }
@@ -39,10 +44,15 @@ int main(int argc, char** argv) {
         exit(1);
     }
 
+    const char* test_file = NULL;
+    if ((argc == 5) && (strcmp(argv[4], "--stdin") != 0)) {
+        test_file = argv[4];
+    }
+
     /**
-     * Parse input data from standard input
+     * Parse input data from test file (or standard input)
      */
-    AMRInput* input = parseInput();
+    AMRInput* input = parseInput(test_file, num_threads);
 
     /**
      * Run and collect timing information
@@ -87,16 +97,21 @@ AMROutput run(AMRInput* input, float affect_rate, float epsilon, Count num_threa
     maxs              = malloc(num_threads * sizeof(*maxs));
     mins              = malloc(num_threads * sizeof(*mins));
     AMRMaxMin max_min = getMaxMin(input);
-    DSV* updated_vals = malloc(input->N * sizeof(*updated_vals));
+    DSV* updated_vals = arenaAlloc(input->arena, input->N * sizeof(*updated_vals));
     starts = malloc((num_threads + 1) * sizeof(*starts));
     splitByNhbrs(input, num_threads);
 
     /**
-     * updated_vals and input->vals are swapped during
-     * execution, need to remember originals for clean up
+     * Fold the coefficients that stay constant for the run into weights
      */
-    DSV* orig_vals         = input->vals;
-    DSV* orig_updated_vals = updated_vals;
+    Weight* diag_weights = arenaAlloc(input->arena, input->N * sizeof(*diag_weights));
+    Weight* nhbr_weights = arenaAlloc(input->arena, input->total_nhbrs * sizeof(*nhbr_weights));
+    computeWeightRange(input, affect_rate, 0, input->N, diag_weights, nhbr_weights);
+    UpdateKernel kernel = updateKernel(simdKind());
+
+    ConvergenceCheck check;
+    initConvergenceCheck(&check, input, affect_rate, max_min);
+    unsigned long iterations = 0;
 
     pthread_barrier_init(&barrier, NULL, num_threads);
     pthread_t* threads       = malloc(num_threads * sizeof(*threads));
@@ -109,9 +124,14 @@ AMROutput run(AMRInput* input, float affect_rate, float epsilon, Count num_threa
         data_structs[tid].num_threads  = num_threads;
         data_structs[tid].vals         = input->vals;
         data_structs[tid].updated_vals = updated_vals;
+        data_structs[tid].diag_weights = diag_weights;
+        data_structs[tid].nhbr_weights = nhbr_weights;
+        data_structs[tid].kernel       = kernel;
         data_structs[tid].max_min      = &max_min;
         data_structs[tid].priv_max     = &maxs[tid];
         data_structs[tid].priv_min     = &mins[tid];
+        data_structs[tid].check        = &check;
+        data_structs[tid].iterations   = &iterations;
         pthread_create(&threads[tid], NULL, &worker, (void*)&data_structs[tid]);
     }
 
@@ -119,15 +139,17 @@ AMROutput run(AMRInput* input, float affect_rate, float epsilon, Count num_threa
         pthread_join(threads[tid], NULL);
     }
 
-    AMROutput result;
+    AMROutput result = { 0 };
     result.affect_rate = affect_rate;
     result.epsilon     = epsilon;
     result.iterations  = data_structs[0].tid;
     result.max         = max_min.max;
     result.min         = max_min.min;
+    result.parse_bytes   = input->parse_bytes;
+    result.parse_seconds   = input->parse_seconds;
+    result.overlap_seconds = input->overlap_seconds;
 
-    input->vals = orig_vals;
-    free(orig_updated_vals);
+    destroyConvergenceCheck(&check);
     free(maxs);
     free(mins);
     free(threads);
@@ -149,86 +171,64 @@ void* worker(void* data) {
     Count     start = starts[tid];
     Count     end   = starts[tid+1];
 
-    float affect_rate  = worker_data->affect_rate;
     float epsilon      = worker_data->epsilon;
+    DSV*  vals         = worker_data->vals;
     DSV*  updated_vals = worker_data->updated_vals;
     AMRMaxMin* max_min = worker_data->max_min;
 
+    const Weight* diag_weights = worker_data->diag_weights;
+    const Weight* nhbr_weights = worker_data->nhbr_weights;
+    ConvergenceCheck* check    = worker_data->check;
+
     /**
-     * Repeat until convergence
+     * Repeat until convergence (each thread keeps its own copy of the
+     * next check, as thread 0 moves it while the others test it)
      */
-    unsigned long iter;
-    for (iter = 0; (max_min->max - max_min->min) / max_min->max > epsilon; ++iter) {
+    unsigned long iter       = 0;
+    unsigned long next_check = check->next_check;
+    while ((max_min->max - max_min->min) / max_min->max > epsilon) {
         /**
          * For each box handled by this thread
          */
-        DSV priv_max = max_min->min;
-        DSV priv_min = max_min->max;
-        for (Count i = start; i < end; ++i) {
-            BoxData* box = &input->boxes[i];
-            /**
-             * Compute updated DSV
-             */
-            updated_vals[i] = box->self_overlap * input->vals[i];
-            for (Count nhbr = 0; nhbr < box->num_nhbrs; ++nhbr) {
-                updated_vals[i] += box->overlaps[nhbr] * input->vals[box->nhbr_ids[nhbr]];
-            }
-            updated_vals[i] /= box->perimeter;
-            updated_vals[i] = input->vals[i] * (1 - affect_rate)
-                + updated_vals[i] * affect_rate;
-
-            /**
-             * Update extremal values
-             */
-            if (updated_vals[i] > priv_max) {
-                priv_max = updated_vals[i];
-            } else if (updated_vals[i] < priv_min) {
-                priv_min = updated_vals[i];
-            }
+        AMRMaxMin range = worker_data->kernel(input, diag_weights, nhbr_weights, start, end, vals, updated_vals);
+        *(worker_data->priv_max) = range.max;
+        *(worker_data->priv_min) = range.min;
+
+        /**
+         * Every thread swaps its own pointers, so a barrier
+         * (no thread still reading the old DSVs) is enough to commit
+         */
+        DSV* temp    = vals;
+        vals         = updated_vals;
+        updated_vals = temp;
+        ++iter;
+        pthread_barrier_wait(&barrier);
+        if (iter < next_check) {
+            continue;
         }
-        *(worker_data->priv_max) = priv_max;
-        *(worker_data->priv_min) = priv_min;
 
         /**
-         * Commit updates
+         * Thread 0 recomputes the convergence condition
+         * (possibly rolling the DSVs back to the last check)
          */
-        {
-            /**
-             * Store old pointer to current DSVs
-             */
-            DSV* temp = input->vals;
-
-            /**
-             * Synchronize with other threads
-             */
-            pthread_barrier_wait(&barrier);
-
-            /**
-             * Thread 0 commit updated DSVs to input struct
-             * and recompute convergence condition
-             */
-            if (tid == 0) {
-                input->vals = updated_vals;
-
-                for (Count alt_tid = 1; alt_tid < num_threads; ++alt_tid) {
-                    if (priv_min > mins[alt_tid]) priv_min = mins[alt_tid];
-                    if (priv_max < maxs[alt_tid]) priv_max = maxs[alt_tid];
-                }
-                max_min->max = priv_max;
-                max_min->min = priv_min;
+        if (tid == 0) {
+            for (Count alt_tid = 1; alt_tid < num_threads; ++alt_tid) {
+                if (range.min > mins[alt_tid]) range.min = mins[alt_tid];
+                if (range.max < maxs[alt_tid]) range.max = maxs[alt_tid];
             }
-
-            /**
-             * Finish swapping updated_vals to point to
-             * the array that was hold previous DSVs
-             */
-            updated_vals = temp;
-
-            /**
-             * Synchronize with other threads
-             */
-            pthread_barrier_wait(&barrier);
+            if (!finishCheck(check, input->N, vals, range, epsilon, &iter)) {
+                max_min->max = range.max;
+                max_min->min = range.min;
+            }
+            *(worker_data->iterations) = iter;
         }
+
+        /**
+         * Synchronize with other threads
+         */
+        pthread_barrier_wait(&barrier);
+        iter       = *(worker_data->iterations);
+        next_check = check->next_check;
     }
 
     /**
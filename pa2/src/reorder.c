@@ -0,0 +1,335 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+#include "reorder.h"
+
+/**
+ * {@inheritDoc}
+ */
+ReorderKind reorderKind() {
+    const char* name = getenv(REORDER_ENV);
+    if ((name == NULL) || (*name == '\0') || (strcmp(name, "none") == 0)) {
+        return REORDER_NONE;
+    }
+    if (strcmp(name, "hilbert") == 0) {
+        return REORDER_HILBERT;
+    }
+    if (strcmp(name, "rcm") == 0) {
+        return REORDER_RCM;
+    }
+    fprintf(stderr, "Error: unknown %s '%s' (expected hilbert, rcm or none)\n", REORDER_ENV, name);
+    exit(1);
+}
+
+/**
+ * {@inheritDoc}
+ */
+const char* reorderName(ReorderKind kind) {
+    switch (kind) {
+        case REORDER_HILBERT: return "hilbert";
+        case REORDER_RCM:     return "rcm";
+        default:              return "none";
+    }
+}
+
+/**
+ * {@inheritDoc}
+ */
+GridProfile measureProfile(const AMRInput* input) {
+    GridProfile result = { 0, 0 };
+    for (Count i = 0; i < input->N; ++i) {
+        const Count* nhbr_ids = &input->nhbr_ids[input->offsets[i]];
+        Count        lowest   = i;
+        for (Count nhbr = 0; nhbr < input->num_nhbrs[i]; ++nhbr) {
+            Count id    = nhbr_ids[nhbr];
+            Count width = (id > i) ? id - i : i - id;
+            if (width > result.bandwidth) {
+                result.bandwidth = width;
+            }
+            if (id < lowest) {
+                lowest = id;
+            }
+        }
+        result.profile += i - lowest;
+    }
+    return result;
+}
+
+/**
+ * Box id paired with its sort key
+ */
+typedef struct KeyedId {
+    unsigned long long key;
+    Count              id;
+} KeyedId;
+
+static int compareKeyedIds(const void* a, const void* b) {
+    const KeyedId* x = a;
+    const KeyedId* y = b;
+    if (x->key != y->key) {
+        return (x->key < y->key) ? -1 : 1;
+    }
+    return (x->id < y->id) ? -1 : (x->id > y->id);
+}
+
+/**
+ * Index of point (x, y) along the Hilbert curve filling
+ * an {@code n} by {@code n} square ({@code n} a power of two)
+ */
+static unsigned long long hilbertIndex(unsigned long long n, unsigned long long x, unsigned long long y) {
+    unsigned long long d = 0;
+    for (unsigned long long s = n / 2; s > 0; s /= 2) {
+        unsigned long long rx = (x & s) > 0;
+        unsigned long long ry = (y & s) > 0;
+        d += s * s * ((3 * rx) ^ ry);
+        if (ry == 0) {
+            if (rx == 1) {
+                x = n - 1 - x;
+                y = n - 1 - y;
+            }
+            unsigned long long temp = x;
+            x = y;
+            y = temp;
+        }
+    }
+    return d;
+}
+
+/**
+ * Orders boxes along the Hilbert curve through their centroids
+ */
+static void hilbertOrder(const AMRInput* input, Count* order) {
+    /**
+     * Centroids are taken at twice the grid resolution so they stay integral,
+     * and coarsened if needed so the curve index fits in 64 bits
+     */
+    unsigned long long side  = 2 * (unsigned long long) ((input->rows > input->cols) ? input->rows : input->cols);
+    unsigned           shift = 0;
+    while ((side >> shift) > (1ULL << 32)) {
+        ++shift;
+    }
+    unsigned long long n = 1;
+    while (n < (side >> shift) + 1) {
+        n *= 2;
+    }
+
+    KeyedId* keyed = malloc(input->N * sizeof(*keyed));
+    for (Count i = 0; i < input->N; ++i) {
+        const BoxBounds* box_bounds = &input->bounds[i];
+        unsigned long long x = ((unsigned long long) box_bounds->x_min + box_bounds->x_max) >> shift;
+        unsigned long long y = ((unsigned long long) box_bounds->y_min + box_bounds->y_max) >> shift;
+        keyed[i] = (KeyedId) { hilbertIndex(n, x, y), i };
+    }
+    qsort(keyed, input->N, sizeof(*keyed), compareKeyedIds);
+    for (Count i = 0; i < input->N; ++i) {
+        order[i] = keyed[i].id;
+    }
+    free(keyed);
+}
+
+/**
+ * Breadth-first search from {@code root} over boxes not yet {@code placed},
+ * tagging each box reached with {@code stamp}
+ *
+ * @param queue room for the component's boxes
+ * @param last  set to the box of lowest neighbor count in the last level
+ * @return number of levels below the root
+ */
+static Count levelSearch(const AMRInput* input, Count root, Count stamp, Count* marks,
+                         const unsigned char* placed, Count* queue, Count* last) {
+    Count head = 0, tail = 0, depth = 0;
+    queue[tail++] = root;
+    marks[root]   = stamp;
+    while (head < tail) {
+        Count level_end = tail;
+        *last = queue[head];
+        for (Count q = head; q < level_end; ++q) {
+            if (input->num_nhbrs[queue[q]] < input->num_nhbrs[*last]) {
+                *last = queue[q];
+            }
+        }
+        for (; head < level_end; ++head) {
+            Count        id       = queue[head];
+            const Count* nhbr_ids = &input->nhbr_ids[input->offsets[id]];
+            for (Count nhbr = 0; nhbr < input->num_nhbrs[id]; ++nhbr) {
+                Count nhbr_id = nhbr_ids[nhbr];
+                if (!placed[nhbr_id] && (marks[nhbr_id] != stamp)) {
+                    marks[nhbr_id] = stamp;
+                    queue[tail++]  = nhbr_id;
+                }
+            }
+        }
+        if (head < tail) {
+            ++depth;
+        }
+    }
+    return depth;
+}
+
+/**
+ * Orders boxes by reverse Cuthill-McKee
+ */
+static void rcmOrder(const AMRInput* input, Count* order) {
+    Count          N      = input->N;
+    unsigned char* placed = calloc(N, sizeof(*placed));
+    Count*         marks  = malloc(N * sizeof(*marks));
+    Count*         queue  = malloc(N * sizeof(*queue));
+    KeyedId*       seeds  = malloc(N * sizeof(*seeds));
+    for (Count i = 0; i < N; ++i) {
+        marks[i] = 0;
+        seeds[i] = (KeyedId) { input->num_nhbrs[i], i };
+    }
+    qsort(seeds, N, sizeof(*seeds), compareKeyedIds);
+
+    /**
+     * Each component starts at its unplaced box of lowest neighbor count
+     * (the whole component is placed at once), moved to a pseudo-peripheral
+     * box by repeated searches from the last level while the depth grows
+     */
+    Count placed_count = 0, stamp = 0;
+    for (Count s = 0; s < N; ++s) {
+        Count root = seeds[s].id;
+        if (placed[root]) {
+            continue;
+        }
+        Count last;
+        Count depth = levelSearch(input, root, ++stamp, marks, placed, queue, &last);
+        for (int tries = 0; tries < 8; ++tries) {
+            Count next_last;
+            Count next_depth = levelSearch(input, last, ++stamp, marks, placed, queue, &next_last);
+            if (next_depth <= depth) {
+                break;
+            }
+            root  = last;
+            depth = next_depth;
+            last  = next_last;
+        }
+
+        /**
+         * Cuthill-McKee: breadth-first, each box's new
+         * neighbors in order of neighbor count
+         */
+        Count head = placed_count;
+        order[placed_count++] = root;
+        placed[root] = 1;
+        for (; head < placed_count; ++head) {
+            Count        id       = order[head];
+            const Count* nhbr_ids = &input->nhbr_ids[input->offsets[id]];
+            Count        first    = placed_count;
+            for (Count nhbr = 0; nhbr < input->num_nhbrs[id]; ++nhbr) {
+                Count nhbr_id = nhbr_ids[nhbr];
+                if (!placed[nhbr_id]) {
+                    placed[nhbr_id] = 1;
+                    Count pos = placed_count++;
+                    while ((pos > first)
+                           && ((input->num_nhbrs[order[pos - 1]] > input->num_nhbrs[nhbr_id])
+                               || ((input->num_nhbrs[order[pos - 1]] == input->num_nhbrs[nhbr_id])
+                                   && (order[pos - 1] > nhbr_id)))) {
+                        order[pos] = order[pos - 1];
+                        --pos;
+                    }
+                    order[pos] = nhbr_id;
+                }
+            }
+        }
+    }
+
+    for (Count i = 0; i < N / 2; ++i) {
+        Count temp       = order[i];
+        order[i]         = order[N - 1 - i];
+        order[N - 1 - i] = temp;
+    }
+
+    free(seeds);
+    free(queue);
+    free(marks);
+    free(placed);
+}
+
+/**
+ * {@inheritDoc}
+ */
+Count* computeOrder(const AMRInput* input, ReorderKind kind, Arena* arena) {
+    Count* order = arenaAlloc(arena, input->N * sizeof(*order));
+    if (kind == REORDER_HILBERT) {
+        hilbertOrder(input, order);
+    } else if (kind == REORDER_RCM) {
+        rcmOrder(input, order);
+    } else {
+        for (Count i = 0; i < input->N; ++i) {
+            order[i] = i;
+        }
+    }
+    return order;
+}
+
+/**
+ * {@inheritDoc}
+ */
+void applyOrder(AMRInput* input, const Count* order) {
+    Arena* arena = input->arena;
+    Count  N     = input->N;
+
+    Count* new_ids = malloc(N * sizeof(*new_ids));
+    for (Count i = 0; i < N; ++i) {
+        new_ids[order[i]] = i;
+    }
+
+    Coord*     perimeters    = arenaAlloc(arena, N * sizeof(*perimeters));
+    Count*     num_nhbrs     = arenaAlloc(arena, N * sizeof(*num_nhbrs));
+    Offset*    offsets       = arenaAlloc(arena, N * sizeof(*offsets));
+    Coord*     self_overlaps = arenaAlloc(arena, N * sizeof(*self_overlaps));
+    BoxBounds* bounds        = arenaAlloc(arena, N * sizeof(*bounds));
+    DSV*       vals          = arenaAlloc(arena, N * sizeof(*vals));
+    Count*     loaded_ids    = arenaAlloc(arena, N * sizeof(*loaded_ids));
+    Offset     total_nhbrs   = 0;
+    for (Count i = 0; i < N; ++i) {
+        Count id = order[i];
+        perimeters[i]    = input->perimeters[id];
+        num_nhbrs[i]     = input->num_nhbrs[id];
+        self_overlaps[i] = input->self_overlaps[id];
+        bounds[i]        = input->bounds[id];
+        vals[i]          = input->vals[id];
+        loaded_ids[i]    = (input->order != NULL) ? input->order[id] : id;
+        offsets[i]       = total_nhbrs;
+        total_nhbrs     += num_nhbrs[i];
+    }
+
+    Count* nhbr_ids = arenaAlloc(arena, total_nhbrs * sizeof(*nhbr_ids));
+    Coord* overlaps = arenaAlloc(arena, total_nhbrs * sizeof(*overlaps));
+    for (Count i = 0; i < N; ++i) {
+        const Count* row_ids = &input->nhbr_ids[input->offsets[order[i]]];
+        for (Count nhbr = 0; nhbr < num_nhbrs[i]; ++nhbr) {
+            nhbr_ids[offsets[i] + nhbr] = new_ids[row_ids[nhbr]];
+        }
+        memcpy(&overlaps[offsets[i]], &input->overlaps[input->offsets[order[i]]],
+               num_nhbrs[i] * sizeof(*overlaps));
+    }
+
+    input->perimeters    = perimeters;
+    input->num_nhbrs     = num_nhbrs;
+    input->offsets       = offsets;
+    input->self_overlaps = self_overlaps;
+    input->nhbr_ids      = nhbr_ids;
+    input->overlaps      = overlaps;
+    input->bounds        = bounds;
+    input->vals          = vals;
+    input->order         = loaded_ids;
+
+    free(new_ids);
+}
+
+/**
+ * {@inheritDoc}
+ */
+void restoreOrder(const AMRInput* input, const DSV* vals, DSV* original_vals) {
+    if (input->order == NULL) {
+        memcpy(original_vals, vals, input->N * sizeof(*original_vals));
+        return;
+    }
+    for (Count i = 0; i < input->N; ++i) {
+        original_vals[input->order[i]] = vals[i];
+    }
+}
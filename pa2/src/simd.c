@@ -0,0 +1,252 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "simd.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAVE_X86 1
+#else
+#define HAVE_X86 0
+#endif
+
+/**
+ * {@inheritDoc}
+ */
+SimdKind simdSupported() {
+    #if HAVE_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        return SIMD_AVX512;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        return SIMD_AVX2;
+    }
+    #endif
+    return SIMD_SCALAR;
+}
+
+/**
+ * {@inheritDoc}
+ */
+SimdKind simdKind() {
+    SimdKind    supported = simdSupported();
+    const char* name      = getenv(SIMD_ENV);
+    if ((name == NULL) || (*name == '\0')) {
+        return supported;
+    }
+    SimdKind cap;
+    if (strcmp(name, "scalar") == 0) {
+        cap = SIMD_SCALAR;
+    } else if (strcmp(name, "avx2") == 0) {
+        cap = SIMD_AVX2;
+    } else if (strcmp(name, "avx512") == 0) {
+        cap = SIMD_AVX512;
+    } else {
+        fprintf(stderr, "Error: unknown %s '%s' (expected scalar, avx2 or avx512)\n", SIMD_ENV, name);
+        exit(1);
+    }
+    return (cap < supported) ? cap : supported;
+}
+
+/**
+ * {@inheritDoc}
+ */
+const char* simdName(SimdKind kind) {
+    switch (kind) {
+        case SIMD_AVX2:   return "avx2";
+        case SIMD_AVX512: return "avx512";
+        default:          return "scalar";
+    }
+}
+
+/**
+ * One box at a time, one neighbor at a time
+ */
+static AMRMaxMin updateScalar(const AMRInput* input, const Weight* diag_weights, const Weight* nhbr_weights,
+                              Count start, Count end, const DSV* vals, DSV* updated_vals) {
+    AMRMaxMin range = { -HUGE_VAL, HUGE_VAL };
+    for (Count i = start; i < end; ++i) {
+        const Count*  nhbr_ids = &input->nhbr_ids[input->offsets[i]];
+        const Weight* weights  = &nhbr_weights[input->offsets[i]];
+        DSV updated = diag_weights[i] * vals[i];
+        for (Count nhbr = 0; nhbr < input->num_nhbrs[i]; ++nhbr) {
+            updated += weights[nhbr] * vals[nhbr_ids[nhbr]];
+        }
+        updated_vals[i] = updated;
+        range.max = (updated > range.max) ? updated : range.max;
+        range.min = (updated < range.min) ? updated : range.min;
+    }
+    return range;
+}
+
+#if HAVE_X86
+/**
+ * The vector kernels take the k-th neighbor of each of their boxes at once,
+ * gathering the ids and weights at each row's offset plus k and then the
+ * neighbors' DSVs (with the ids widened to 64 bits, as 32-bit gather
+ * indices are signed); lanes whose row is shorter than k are masked off (and
+ * add nothing), so boxes of any degree share a vector. Products and sums
+ * are kept separate (no FMA) to round like the scalar kernel. The extremal
+ * DSVs are tracked per lane and only reduced across lanes at the end.
+ */
+#define AVX2_TARGET   __attribute__((target("avx2")))
+#define AVX512_TARGET __attribute__((target("avx512f")))
+
+/**
+ * Row offsets of 4 boxes, widened to 64 bits
+ */
+AVX2_TARGET static inline __m256i loadOffsets4(const Offset* offsets) {
+    #if (WIDE_OFFSETS != 0)
+    return _mm256_loadu_si256((const __m256i*) offsets);
+    #else
+    return _mm256_cvtepu32_epi64(_mm_loadu_si128((const __m128i*) offsets));
+    #endif
+}
+
+/**
+ * Diagonal weights of 4 boxes, as DSVs
+ */
+AVX2_TARGET static inline __m256d loadWeights4(const Weight* weights) {
+    #if (FLOAT_WEIGHTS != 0)
+    return _mm256_cvtps_pd(_mm_loadu_ps(weights));
+    #else
+    return _mm256_loadu_pd(weights);
+    #endif
+}
+
+/**
+ * Neighbor weights at 4 offsets, as DSVs (0 in inactive lanes)
+ */
+AVX2_TARGET static inline __m256d gatherWeights4(const Weight* weights, __m256i offsets, __m128i active) {
+    #if (FLOAT_WEIGHTS != 0)
+    return _mm256_cvtps_pd(_mm256_mask_i64gather_ps(_mm_setzero_ps(), weights, offsets,
+                                                    _mm_castsi128_ps(active), sizeof(*weights)));
+    #else
+    return _mm256_mask_i64gather_pd(_mm256_setzero_pd(), weights, offsets,
+                                    _mm256_castsi256_pd(_mm256_cvtepi32_epi64(active)), sizeof(*weights));
+    #endif
+}
+
+/**
+ * 4 boxes per vector, with the last {@code (end - start) % 4} boxes scalar
+ */
+AVX2_TARGET static AMRMaxMin updateAVX2(const AMRInput* input, const Weight* diag_weights, const Weight* nhbr_weights,
+                                        Count start, Count end, const DSV* vals, DSV* updated_vals) {
+    __m256d maxs = _mm256_set1_pd(-HUGE_VAL);
+    __m256d mins = _mm256_set1_pd(HUGE_VAL);
+    Count   i    = start;
+    for (; end - i >= 4; i += 4) {
+        __m128i degrees = _mm_loadu_si128((const __m128i*) &input->num_nhbrs[i]);
+        __m256i offsets = loadOffsets4(&input->offsets[i]);
+        __m256d sums    = _mm256_mul_pd(loadWeights4(&diag_weights[i]), _mm256_loadu_pd(&vals[i]));
+        __m128i active  = _mm_cmpgt_epi32(degrees, _mm_setzero_si128());
+        for (int k = 1; _mm_movemask_epi8(active) != 0; ++k) {
+            __m128i ids = _mm256_mask_i64gather_epi32(_mm_setzero_si128(), (const int*) input->nhbr_ids,
+                                                      offsets, active, sizeof(Count));
+            __m256d nhbr_vals = _mm256_mask_i64gather_pd(_mm256_setzero_pd(), vals, _mm256_cvtepu32_epi64(ids),
+                                                         _mm256_castsi256_pd(_mm256_cvtepi32_epi64(active)),
+                                                         sizeof(*vals));
+            sums    = _mm256_add_pd(sums, _mm256_mul_pd(gatherWeights4(nhbr_weights, offsets, active), nhbr_vals));
+            offsets = _mm256_add_epi64(offsets, _mm256_set1_epi64x(1));
+            active  = _mm_cmpgt_epi32(degrees, _mm_set1_epi32(k));
+        }
+        _mm256_storeu_pd(&updated_vals[i], sums);
+        maxs = _mm256_max_pd(maxs, sums);
+        mins = _mm256_min_pd(mins, sums);
+    }
+
+    AMRMaxMin range = updateScalar(input, diag_weights, nhbr_weights, i, end, vals, updated_vals);
+    DSV lanes[4];
+    _mm256_storeu_pd(lanes, maxs);
+    for (int lane = 0; lane < 4; ++lane) {
+        range.max = (lanes[lane] > range.max) ? lanes[lane] : range.max;
+    }
+    _mm256_storeu_pd(lanes, mins);
+    for (int lane = 0; lane < 4; ++lane) {
+        range.min = (lanes[lane] < range.min) ? lanes[lane] : range.min;
+    }
+    return range;
+}
+
+/**
+ * Row offsets of up to 8 boxes, widened to 64 bits (0 past the mask)
+ */
+AVX512_TARGET static inline __m512i loadOffsets8(const Offset* offsets, __mmask8 boxes) {
+    #if (WIDE_OFFSETS != 0)
+    return _mm512_maskz_loadu_epi64(boxes, offsets);
+    #else
+    return _mm512_cvtepu32_epi64(_mm512_castsi512_si256(_mm512_maskz_loadu_epi32(boxes, offsets)));
+    #endif
+}
+
+/**
+ * Diagonal weights of up to 8 boxes, as DSVs (0 past the mask)
+ */
+AVX512_TARGET static inline __m512d loadWeights8(const Weight* weights, __mmask8 boxes) {
+    #if (FLOAT_WEIGHTS != 0)
+    return _mm512_cvtps_pd(_mm512_castps512_ps256(_mm512_maskz_loadu_ps(boxes, weights)));
+    #else
+    return _mm512_maskz_loadu_pd(boxes, weights);
+    #endif
+}
+
+/**
+ * Neighbor weights at 8 offsets, as DSVs (0 in inactive lanes)
+ */
+AVX512_TARGET static inline __m512d gatherWeights8(const Weight* weights, __m512i offsets, __mmask8 active) {
+    #if (FLOAT_WEIGHTS != 0)
+    return _mm512_cvtps_pd(_mm512_mask_i64gather_ps(_mm256_setzero_ps(), active, offsets, weights, sizeof(*weights)));
+    #else
+    return _mm512_mask_i64gather_pd(_mm512_setzero_pd(), active, offsets, weights, sizeof(*weights));
+    #endif
+}
+
+/**
+ * 8 boxes per vector, the last (partial) vector masked
+ */
+AVX512_TARGET static AMRMaxMin updateAVX512(const AMRInput* input, const Weight* diag_weights, const Weight* nhbr_weights,
+                                            Count start, Count end, const DSV* vals, DSV* updated_vals) {
+    __m512d maxs = _mm512_set1_pd(-HUGE_VAL);
+    __m512d mins = _mm512_set1_pd(HUGE_VAL);
+    for (Count i = start; i < end; i += 8) {
+        __mmask8 boxes   = (end - i >= 8) ? 0xFF : (__mmask8) ((1u << (end - i)) - 1);
+        __m512i  degrees = _mm512_cvtepu32_epi64(_mm512_castsi512_si256(
+                               _mm512_maskz_loadu_epi32(boxes, &input->num_nhbrs[i])));
+        __m512i  offsets = loadOffsets8(&input->offsets[i], boxes);
+        __m512d  sums    = _mm512_mul_pd(loadWeights8(&diag_weights[i], boxes), _mm512_maskz_loadu_pd(boxes, &vals[i]));
+        __mmask8 active  = _mm512_cmpgt_epu64_mask(degrees, _mm512_setzero_si512());
+        for (long long k = 1; active != 0; ++k) {
+            __m256i ids = _mm512_mask_i64gather_epi32(_mm256_setzero_si256(), active, offsets,
+                                                      input->nhbr_ids, sizeof(Count));
+            __m512d nhbr_vals = _mm512_mask_i64gather_pd(_mm512_setzero_pd(), active, _mm512_cvtepu32_epi64(ids),
+                                                         vals, sizeof(*vals));
+            sums    = _mm512_mask_add_pd(sums, active, sums,
+                                         _mm512_mul_pd(gatherWeights8(nhbr_weights, offsets, active), nhbr_vals));
+            offsets = _mm512_add_epi64(offsets, _mm512_set1_epi64(1));
+            active  = _mm512_cmpgt_epu64_mask(degrees, _mm512_set1_epi64(k));
+        }
+        _mm512_mask_storeu_pd(&updated_vals[i], boxes, sums);
+        maxs = _mm512_mask_max_pd(maxs, boxes, maxs, sums);
+        mins = _mm512_mask_min_pd(mins, boxes, mins, sums);
+    }
+
+    AMRMaxMin range = { _mm512_reduce_max_pd(maxs), _mm512_reduce_min_pd(mins) };
+    return range;
+}
+#endif
+
+/**
+ * {@inheritDoc}
+ */
+UpdateKernel updateKernel(SimdKind kind) {
+    switch (kind) {
+        #if HAVE_X86
+        case SIMD_AVX2:   return &updateAVX2;
+        case SIMD_AVX512: return &updateAVX512;
+        #endif
+        default:          return &updateScalar;
+    }
+}
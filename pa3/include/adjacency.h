@@ -0,0 +1,36 @@
+#pragma once
+
+#include "arena.h"
+#include "ingest.h"
+
+/**
+ * Edge of a box on a grid line, as seen by the sweep.
+ *
+ * {@code line}   - y of a horizontal edge, x of a vertical edge
+ * {@code lo}     - start of the edge along the line
+ * {@code hi}     - end of the edge along the line
+ * {@code id}     - box the edge belongs to
+ * {@code starts} - 1 if the box starts at the line (lies below/right of it),
+ *                  0 if it ends there (lies above/left of it)
+ */
+typedef struct BoxEdge {
+    Coord line;
+    Coord lo, hi;
+    Count id;
+    int   starts;
+} BoxEdge;
+
+/**
+ * Finds the TOP/BOTTOM/LEFT/RIGHT neighbors of every box from the box
+ * extents alone. Edges are sorted by line, then the boxes ending and the
+ * boxes starting on each line are swept against each other, so the whole
+ * construction is O(N log N). Two boxes are neighbors when their edges on
+ * a line overlap with positive length (touching corners do not count).
+ * Neighbors in each direction are ordered along the shared edge.
+ *
+ * @param records {@code GridRecords} with {@code N} and {@code bounds} filled in;
+ *                {@code dir_nhbrs}, {@code offsets} and {@code nhbr_ids} are filled in
+ * @param arena   {@code Arena} for {@code nhbr_ids}
+ * @param scratch {@code Arena} for the sweep's temporary arrays
+ */
+void buildAdjacency(GridRecords* records, Arena* arena, Arena* scratch);
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "common.h"
+
+/**
+ * Environment variable enabling the multicolor Gauss-Seidel update
+ * (set to 1), unset or 0 for the two-buffer Jacobi update
+ */
+#define GAUSS_SEIDEL_ENV "AMR_GAUSS_SEIDEL"
+
+/**
+ * Boxes grouped into color classes, no two neighbors sharing a color, and
+ * renumbered so each class is a range of ids (in the order they had before).
+ * Boxes of a class only read boxes of other classes, so a class can be
+ * updated in place, in any order or in parallel:
+ *
+ * {@code num_colors} - number of classes
+ * {@code starts}     - class c is ids {@code starts[c]} to {@code starts[c + 1]} (exclusive)
+ */
+typedef struct ColorClasses {
+    Count  num_colors;
+    Count* starts;
+} ColorClasses;
+
+/**
+ * Reads whether the Gauss-Seidel update is enabled from {@code GAUSS_SEIDEL_ENV}
+ */
+int gaussSeidelEnabled();
+
+/**
+ * Colors a grid greedily in id order (each box takes the smallest color none
+ * of its neighbors, or of the boxes listing it, has) and renumbers it by color
+ *
+ * @param input pointer to populated {@code AMRInput} struct, renumbered in place
+ * @return the color classes, allocated from the input's arena
+ */
+ColorClasses* colorBoxes(AMRInput* input);
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <stddef.h>
+
+#include "common.h"
+
+/**
+ * Size of the blocks used when input can not be
+ * memory-mapped (e.g. when reading from a pipe)
+ */
+#define READ_BLOCK_SIZE (1 << 20)
+
+/**
+ * Raw bytes of an input file, along with a cursor
+ * for the tokenizer.
+ *
+ * {@code data}   - first byte of the input
+ * {@code end}    - one past the last byte of the input
+ * {@code pos}    - next byte to be tokenized
+ * {@code mapped} - non-zero if {@code data} is memory-mapped,
+ *                  zero if it was read in blocks into the heap
+ * {@code stream} - decompressor feeding the buffer, {@code NULL} if the
+ *                  whole input is in memory. For streams, {@code data} and
+ *                  {@code end} bound the current window only, and
+ *                  {@code size} counts the bytes decompressed so far
+ */
+typedef struct InputBuffer {
+    const char* data;
+    const char* end;
+    const char* pos;
+    size_t      size;
+    int         mapped;
+
+    struct InputStream* stream;
+} InputBuffer;
+
+/**
+ * Opens the given file for tokenizing.
+ * Regular files are memory-mapped, anything else
+ * (pipes, terminals) is read in blocks of {@code READ_BLOCK_SIZE}.
+ * Gzip and zstd compressed files (detected by their magic bytes) are
+ * decompressed on a separate thread while they are tokenized.
+ * Should be paired with {@code closeInputBuffer}.
+ *
+ * @param file_name path of the file, or {@code NULL} for stdin
+ * @return the opened {@code InputBuffer}
+ */
+InputBuffer* openInputBuffer(const char* file_name);
+
+/**
+ * Releases an {@code InputBuffer} created with {@code openInputBuffer}.
+ *
+ * @param buffer pointer to {@code InputBuffer} returned by {@code openInputBuffer}
+ */
+void closeInputBuffer(InputBuffer* buffer);
+
+/**
+ * Consumes the next token if it is the given keyword,
+ * skipping leading whitespace. Leaves other tokens in place.
+ *
+ * @param buffer  {@code InputBuffer} to read from
+ * @param keyword keyword to look for
+ * @return 1 if the keyword was consumed, 0 otherwise
+ */
+int readKeyword(InputBuffer* buffer, const char* keyword);
+
+/**
+ * Reads the next unsigned decimal integer, skipping leading whitespace.
+ *
+ * @param buffer {@code InputBuffer} to read from
+ * @param value  location to store the parsed value
+ * @return 1 on success, 0 on malformed input, a value past {@code Count} or end of input
+ */
+int readCount(InputBuffer* buffer, Count* value);
+
+/**
+ * Reads the next unsigned decimal integer, skipping leading whitespace.
+ *
+ * @param buffer {@code InputBuffer} to read from
+ * @param value  location to store the parsed value
+ * @return 1 on success, 0 on malformed input, a value past {@code Coord} or end of input
+ */
+int readCoord(InputBuffer* buffer, Coord* value);
+
+/**
+ * Reads the next floating-point value, skipping leading whitespace.
+ * Accepts an optional sign, fraction and exponent.
+ *
+ * @param buffer {@code InputBuffer} to read from
+ * @param value  location to store the parsed value
+ * @return 1 on success, 0 on malformed input or end of input
+ */
+int readDSV(InputBuffer* buffer, DSV* value);
+
+/**
+ * Helper function for computing elapsed wall-clock seconds
+ */
+static inline double secondsSince(struct timespec before) {
+    struct timespec after;
+    clock_gettime(CLOCK_REALTIME, &after);
+    return (double) (
+        (after.tv_sec - before.tv_sec) +
+        ((after.tv_nsec - before.tv_nsec) / 1000000000.0)
+    );
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <limits.h>
+
+#include "common.h"
+#include "reader.h"
+
+/**
+ * Environment variable enabling the shared topology segment
+ * (any value other than empty or "0")
+ */
+#define SHARED_TOPOLOGY_ENV "AMR_SHARED_TOPOLOGY"
+
+/**
+ * How often (and how many microseconds apart) to look for a segment
+ * that exists but has not been filled in yet, before treating it as
+ * abandoned by a crashed publisher
+ */
+#define SHARED_RETRIES     1000
+#define SHARED_RETRY_DELAY 1000
+
+/**
+ * Named POSIX shared-memory segment holding a grid
+ * as a compiled binary grid (see {@code amrb.h}).
+ *
+ * The first process to open a segment for some grid content becomes its
+ * publisher: it holds an exclusive lock on the segment until the grid is
+ * written. Later processes take a shared lock (so wait for the publisher),
+ * then map the segment read-only and use the topology in place, so
+ * concurrent runs on the same grid share one copy of it.
+ * Segments outlive the processes, like the parse cache.
+ *
+ * {@code name} - name of the segment (content hash, size and type sizes)
+ * {@code fd}   - locked segment to publish into, -1 if not the publisher
+ */
+typedef struct SharedSegment {
+    char name[NAME_MAX];
+    int  fd;
+} SharedSegment;
+
+/**
+ * Attaches to the shared segment of a text grid, if enabled.
+ * Streamed (compressed) input is never shared, as it is not all in memory to hash.
+ * If no other process has published the grid yet, the segment is
+ * created and locked, and {@code publishSharedInput()} should be called
+ * once the grid is parsed.
+ *
+ * @param buffer  opened {@code InputBuffer} holding the grid
+ * @param segment segment to fill in
+ * @return the attached {@code AMRInput} (topology in shared memory,
+ *         private DSVs), or {@code NULL} if the grid has to be parsed
+ */
+AMRInput* attachSharedInput(const InputBuffer* buffer, SharedSegment* segment);
+
+/**
+ * Writes a parsed grid to a segment created by {@code attachSharedInput()}
+ * and releases the lock, so waiting processes can attach.
+ * Does nothing if this process is not the publisher.
+ *
+ * @param segment segment from {@code attachSharedInput()}
+ * @param input   pointer to the populated {@code AMRInput} struct
+ */
+void publishSharedInput(SharedSegment* segment, AMRInput* input);
@@ -0,0 +1,194 @@
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "amrb.h"
+#include "cache.h"
+
+#define CACHE_STAMP_MAGIC   "AMRS"
+#define CACHE_STAMP_VERSION 1
+
+/**
+ * Contents of a stamp file, see {@code CacheKey}
+ */
+typedef struct CacheStamp {
+    char     magic[4];
+    uint32_t version;
+    uint64_t size;
+    int64_t  mtime_sec;
+    int64_t  mtime_nsec;
+    uint64_t content_hash;
+} CacheStamp;
+
+#define HASH_SEED  0xcbf29ce484222325ULL
+#define HASH_PRIME 0x100000001b3ULL
+
+/**
+ * {@inheritDoc}
+ *
+ * FNV-1a over 8-byte words, with an extra shift to mix high bits down.
+ */
+uint64_t hashBytes(const char* data, size_t size) {
+    uint64_t hash = HASH_SEED ^ size;
+    size_t   i    = 0;
+    for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+        uint64_t word;
+        memcpy(&word, data + i, sizeof(word));
+        hash  = (hash ^ word) * HASH_PRIME;
+        hash ^= hash >> 29;
+    }
+    for (; i < size; ++i) {
+        hash = (hash ^ (unsigned char) data[i]) * HASH_PRIME;
+    }
+    return hash ^ (hash >> 32);
+}
+
+/**
+ * Reads the stamp at {@code path}, returns non-zero if it is valid
+ */
+static int readStamp(const char* path, CacheStamp* stamp) {
+    FILE* file = fopen(path, "rb");
+    if (file == NULL) {
+        return 0;
+    }
+    int valid = (fread(stamp, sizeof(*stamp), 1, file) == 1)
+        && (memcmp(stamp->magic, CACHE_STAMP_MAGIC, sizeof(stamp->magic)) == 0)
+        && (stamp->version == CACHE_STAMP_VERSION);
+    fclose(file);
+    return valid;
+}
+
+/**
+ * Moves {@code tmp_path} to {@code path}, warning on failure
+ */
+static void renameInto(const char* tmp_path, const char* path) {
+    if (rename(tmp_path, path) != 0) {
+        fprintf(stderr, "Warning: could not update parse cache %s: %s\n", path, strerror(errno));
+        unlink(tmp_path);
+    }
+}
+
+/**
+ * {@inheritDoc}
+ */
+int initCacheKey(const char* file_name, const InputBuffer* buffer, CacheKey* key) {
+    const char* cache_dir = getenv(CACHE_DIR_ENV);
+    if ((cache_dir == NULL) || (*cache_dir == '\0') || (buffer->stream != NULL)) {
+        return 0;
+    }
+
+    struct stat info;
+    int status = (file_name != NULL) ? stat(file_name, &info) : fstat(STDIN_FILENO, &info);
+    int regular = (status == 0) && S_ISREG(info.st_mode) && ((uint64_t) info.st_size == buffer->size);
+
+    key->size          = buffer->size;
+    key->mtime_sec     = regular ? (int64_t) info.st_mtim.tv_sec  : 0;
+    key->mtime_nsec    = regular ? (int64_t) info.st_mtim.tv_nsec : 0;
+    key->stamp_path[0] = '\0';
+
+    /**
+     * Regular files with an up-to-date stamp skip hashing,
+     * pipes are always hashed
+     */
+    CacheStamp stamp;
+    int fresh = 0;
+    if (regular) {
+        snprintf(key->stamp_path, sizeof(key->stamp_path), "%s/%016llx-%016llx.stamp",
+                 cache_dir, (unsigned long long) info.st_dev, (unsigned long long) info.st_ino);
+        fresh = readStamp(key->stamp_path, &stamp)
+            && (stamp.size == key->size)
+            && (stamp.mtime_sec == key->mtime_sec)
+            && (stamp.mtime_nsec == key->mtime_nsec);
+    }
+    key->content_hash = fresh ? stamp.content_hash : hashBytes(buffer->data, buffer->size);
+
+    snprintf(key->entry_path, sizeof(key->entry_path), "%s/%016llx-%016llx-%zu%zu%zu%zu.amrb",
+             cache_dir, (unsigned long long) key->content_hash, (unsigned long long) key->size,
+             sizeof(Count), sizeof(Offset), sizeof(Coord), sizeof(DSV));
+    return 1;
+}
+
+/**
+ * {@inheritDoc}
+ */
+AMRInput* loadCachedInput(const CacheKey* key) {
+    if (access(key->entry_path, R_OK) != 0) {
+        return NULL;
+    }
+    InputBuffer* buffer = openInputBuffer(key->entry_path);
+    if (!isBinaryInput(buffer)) {
+        closeInputBuffer(buffer);
+        return NULL;
+    }
+    AMRInput* input = loadBinaryInput(buffer);
+
+    /**
+     * A hit after re-hashing means only the mtime changed,
+     * refresh the stamp so the next run skips hashing again
+     */
+    CacheStamp stamp;
+    if ((key->stamp_path[0] != '\0')
+        && (!readStamp(key->stamp_path, &stamp)
+            || (stamp.size != key->size)
+            || (stamp.mtime_sec != key->mtime_sec)
+            || (stamp.mtime_nsec != key->mtime_nsec)
+            || (stamp.content_hash != key->content_hash))
+    ) {
+        storeCachedInput(key, NULL);
+    }
+    return input;
+}
+
+/**
+ * {@inheritDoc}
+ *
+ * With a {@code NULL} input only the stamp is written.
+ */
+void storeCachedInput(const CacheKey* key, AMRInput* input) {
+    const char* cache_dir = getenv(CACHE_DIR_ENV);
+    if ((mkdir(cache_dir, 0777) != 0) && (errno != EEXIST)) {
+        fprintf(stderr, "Warning: could not create parse cache %s: %s\n", cache_dir, strerror(errno));
+        return;
+    }
+    if (access(cache_dir, W_OK) != 0) {
+        fprintf(stderr, "Warning: parse cache %s is not writable\n", cache_dir);
+        return;
+    }
+
+    char tmp_path[PATH_MAX + 32];
+    if (input != NULL) {
+        snprintf(tmp_path, sizeof(tmp_path), "%s.%ld.tmp", key->entry_path, (long) getpid());
+        writeBinaryInput(input, tmp_path);
+        renameInto(tmp_path, key->entry_path);
+    }
+
+    if (key->stamp_path[0] != '\0') {
+        CacheStamp stamp;
+        memset(&stamp, 0, sizeof(stamp));
+        memcpy(stamp.magic, CACHE_STAMP_MAGIC, sizeof(stamp.magic));
+        stamp.version      = CACHE_STAMP_VERSION;
+        stamp.size         = key->size;
+        stamp.mtime_sec    = key->mtime_sec;
+        stamp.mtime_nsec   = key->mtime_nsec;
+        stamp.content_hash = key->content_hash;
+
+        snprintf(tmp_path, sizeof(tmp_path), "%s.%ld.tmp", key->stamp_path, (long) getpid());
+        FILE* file = fopen(tmp_path, "wb");
+        if ((file == NULL) || (fwrite(&stamp, sizeof(stamp), 1, file) != 1)) {
+            fprintf(stderr, "Warning: could not write parse cache stamp %s\n", tmp_path);
+            if (file != NULL) {
+                fclose(file);
+                unlink(tmp_path);
+            }
+            return;
+        }
+        if (fclose(file) != 0) {
+            unlink(tmp_path);
+            return;
+        }
+        renameInto(tmp_path, key->stamp_path);
+    }
+}
@@ -1,209 +1,169 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#include "amrb.h"
+#include "arena.h"
+#include "cache.h"
 #include "common.h"
+#include "delta.h"
+#include "ingest.h"
+#include "overlap.h"
+#include "reader.h"
+#include "reorder.h"
+#include "shared.h"
 
 const char* invalid_format = "Error: invalid input\n";
 
 /**
- * Struct to store minimially-processed input
- * for box data
+ * Loads a grid as stored, from a compiled grid, shared memory,
+ * the parse cache or the text itself (in that order of preference)
  */
-#define NUM_DIR 4
-typedef enum { TOP=0, BOTTOM, LEFT, RIGHT } DIRECTION;
-typedef struct BoxInput {
-    Coord x_min, x_max, y_min, y_max;
-    Coord perimeter;
+static AMRInput* loadInput(const char* file_name, Count num_threads) {
+    struct timespec parse_before;
+    clock_gettime(CLOCK_REALTIME, &parse_before);
+    InputBuffer* buffer = openInputBuffer(file_name);
 
     /**
-     * [0] = [TOP] corresponds to top neighbors
-     * [1] = [BOTTOM] corresponds to bottom neighbors
-     * [2] = [LEFT] corresponds to left neighbors
-     * [3] = [RIGHT] corresponds to right neighbors
+     * Compiled binary grids are used in place
      */
-    Count num_nhbrs[NUM_DIR];
-    Count* nhbr_ids[NUM_DIR];
-} BoxInput;
+    if (isBinaryInput(buffer)) {
+        AMRInput* input      = loadBinaryInput(buffer);
+        input->parse_bytes   = buffer->size;
+        input->parse_seconds   = secondsSince(parse_before);
+        input->overlap_seconds = 0;
+        return input;
+    }
 
-/**
- * {@inheritDoc}
- */
-AMRInput* parseInput() {
     /**
-     * Allocate struct
+     * Text grids published by a concurrent run are
+     * attached to in shared memory (if enabled)
      */
-    AMRInput* input = malloc(sizeof(*input));
+    SharedSegment segment;
+    AMRInput*     shared = attachSharedInput(buffer, &segment);
+    if (shared != NULL) {
+        shared->parse_bytes   = buffer->size;
+        shared->parse_seconds   = secondsSince(parse_before);
+        shared->overlap_seconds = 0;
+        closeInputBuffer(buffer);
+        return shared;
+    }
 
     /**
-     * Read in general parameters
+     * Text grids seen before are loaded from the parse cache (if enabled)
      */
-    if (scanf(COUNT_SPEC, &input->N) != 1) {
-        fprintf(stderr, "%s", invalid_format);
-        exit(1);
-    }
-    if (scanf(COORD_SPEC, &input->rows) != 1) {
-        fprintf(stderr, "%s", invalid_format);
-        exit(1);
-    }
-    if (scanf(COORD_SPEC, &input->cols) != 1) {
-        fprintf(stderr, "%s", invalid_format);
-        exit(1);
+    CacheKey cache_key;
+    int      cached = initCacheKey(file_name, buffer, &cache_key);
+    if (cached) {
+        AMRInput* input = loadCachedInput(&cache_key);
+        if (input != NULL) {
+            input->parse_bytes   = buffer->size;
+            input->parse_seconds   = secondsSince(parse_before);
+            input->overlap_seconds = 0;
+            closeInputBuffer(buffer);
+            publishSharedInput(&segment, input);
+            return input;
+        }
     }
 
     /**
-     * Allocate arrays for per-box values
+     * Read box records (in parallel with more than one parse thread)
      */
-    BoxInput* bs = malloc(input->N * sizeof(*bs));
-    input->vals  = malloc(input->N * sizeof(*input->vals));
+    Arena*       arena   = createArena(ARENA_BLOCK_SIZE);
+    Arena*       scratch = createArena(ARENA_BLOCK_SIZE);
+    GridRecords* records = readGridRecords(buffer, parseThreads(), arena, scratch);
 
     /**
-     * Reading in per-box information
+     * Allocate struct
      */
-    for (Count i = 0; i < input->N; ++i) {
-        BoxInput* box_input = &bs[i];
-
-        /**
-         * Verify that ids are sequential
-         */
-        Count id;
-        if (scanf(COUNT_SPEC, &id) != 1) {
-            fprintf(stderr, "%s", invalid_format);
-            exit(1);
-        }
-        if (id != i) {
-            fprintf(stderr, "%s", invalid_format);
-            exit(1);
-        }
+    AMRInput* input = arenaAlloc(arena, sizeof(*input));
+    input->arena  = arena;
+    input->N      = records->N;
+    input->rows   = records->rows;
+    input->cols   = records->cols;
+    input->source = NULL;
 
-        /**
-         * Size and position information
-         */
-        Coord y, x, height, width;
-        if (scanf(COORD_SPEC COORD_SPEC COORD_SPEC COORD_SPEC,
-                  &y,        &x,        &height,   &width)
-            != 4) {
-            fprintf(stderr, "%s", invalid_format);
-            exit(1);
-        }
-        box_input->x_min     = x;
-        box_input->x_max     = x + width;
-        box_input->y_min     = y;
-        box_input->y_max     = y + height;
-        box_input->perimeter = 2 * (height + width);
-
-        /**
-         * Topology information
-         */
-        for (DIRECTION dir = TOP; dir <= RIGHT; ++dir) {
-            Count num_nhbrs;
-            if (scanf(COUNT_SPEC, &num_nhbrs) != 1) {
-                fprintf(stderr, "%s", invalid_format);
-                exit(1);
-            }
-            box_input->num_nhbrs[dir] = num_nhbrs;
-            box_input->nhbr_ids[dir]  = malloc(
-                num_nhbrs * sizeof(*box_input->nhbr_ids[dir])
-            );
-            for (Count nhbr = 0; nhbr < num_nhbrs; ++nhbr) {
-                if (scanf(COUNT_SPEC, &box_input->nhbr_ids[dir][nhbr]) != 1) {
-                    fprintf(stderr, "%s", invalid_format);
-                    exit(1);
-                }
-            }
-        }
+    /**
+     * DSVs and extents are used as read
+     */
+    input->vals   = records->vals;
+    input->bounds = records->bounds;
 
-        /**
-         * DSV information
-         */
-        if (scanf(DSV_SPEC, &input->vals[i]) != 1) {
-            fprintf(stderr, "%s", invalid_format);
-            exit(1);
-        }
-    }
+    /**
+     * Overlaps and self-overlaps are their own (parallel) stage
+     */
+    struct timespec overlap_before;
+    clock_gettime(CLOCK_REALTIME, &overlap_before);
+    input->total_nhbrs   = records->offsets[input->N];
+    input->overlaps      = arenaAlloc(arena, input->total_nhbrs * sizeof(*input->overlaps));
+    input->self_overlaps = arenaAlloc(arena, input->N * sizeof(*input->self_overlaps));
+    computeOverlaps(records, num_threads, input->overlaps, input->self_overlaps);
+    input->overlap_seconds = secondsSince(overlap_before);
 
     /**
-     * Processes box data (currently stored in {@code bs})
-     * to a more convenient format (to be stored in {@code boxes}).
+     * Processes box data (currently stored in {@code records})
+     * to a more convenient format (flat per-box arrays).
      */
-    input->boxes = malloc(input->N * sizeof(*input->boxes));
+    input->offsets  = records->offsets;
+    input->nhbr_ids = records->nhbr_ids;
+
+    input->perimeters = arenaAlloc(arena, input->N * sizeof(*input->perimeters));
+    input->num_nhbrs  = arenaAlloc(arena, input->N * sizeof(*input->num_nhbrs));
     for (Count i = 0; i < input->N; ++i) {
-        BoxData*  box_data  = &input->boxes[i];
-        BoxInput* box_input = &bs[i];
+        BoxBounds* box_bounds = &records->bounds[i];
 
-        box_data->perimeter = box_input->perimeter;
-        box_data->id        = i;
+        input->perimeters[i] = 2 * ((box_bounds->x_max - box_bounds->x_min)
+                                  + (box_bounds->y_max - box_bounds->y_min));
+        input->num_nhbrs[i]  = input->offsets[i + 1] - input->offsets[i];
+    }
 
-        box_data->num_nhbrs = 0;
-        for (DIRECTION dir = TOP; dir <= RIGHT; ++dir) {
-            box_data->num_nhbrs += box_input->num_nhbrs[dir];
-        }
+    /**
+     * Clean up
+     */
+    destroyArena(scratch);
 
-        box_data->nhbr_ids = malloc(
-            box_data->num_nhbrs * sizeof(*box_data->nhbr_ids)
-        );
-        box_data->overlaps = malloc(
-            box_data->num_nhbrs * sizeof(*box_data->overlaps)
-        );
-        
-        box_data->self_overlap = box_data->perimeter;
-        Count total_nhbr = 0;
-        for (Count nhbr = 0;
-             nhbr < box_input->num_nhbrs[TOP];
-             ++nhbr, ++total_nhbr
-        ) {
-            Count nhbr_id = box_input->nhbr_ids[TOP][nhbr];
-            box_data->nhbr_ids[total_nhbr] = nhbr_id;
-            Coord x_max = min(box_input->x_max, bs[nhbr_id].x_max);
-            Coord x_min = max(box_input->x_min, bs[nhbr_id].x_min);
-            box_data->overlaps[total_nhbr] = x_max - x_min;
-            box_data->self_overlap -= x_max - x_min;
-        }
-        for (Count nhbr = 0;
-             nhbr < box_input->num_nhbrs[BOTTOM];
-             ++nhbr, ++total_nhbr
-        ) {
-            Count nhbr_id = box_input->nhbr_ids[BOTTOM][nhbr];
-            box_data->nhbr_ids[total_nhbr] = nhbr_id;
-            Coord x_max = min(box_input->x_max, bs[nhbr_id].x_max);
-            Coord x_min = max(box_input->x_min, bs[nhbr_id].x_min);
-            box_data->overlaps[total_nhbr] = x_max - x_min;
-            box_data->self_overlap -= x_max - x_min;
-        }
-        for (Count nhbr = 0;
-             nhbr < box_input->num_nhbrs[LEFT];
-             ++nhbr, ++total_nhbr
-        ) {
-            Count nhbr_id = box_input->nhbr_ids[LEFT][nhbr];
-            box_data->nhbr_ids[total_nhbr] = nhbr_id;
-            Coord y_max = min(box_input->y_max, bs[nhbr_id].y_max);
-            Coord y_min = max(box_input->y_min, bs[nhbr_id].y_min);
-            box_data->overlaps[total_nhbr] = y_max - y_min;
-            box_data->self_overlap -= y_max - y_min;
-        }
-        for (Count nhbr = 0;
-             nhbr < box_input->num_nhbrs[RIGHT];
-             ++nhbr, ++total_nhbr
-        ) {
-            Count nhbr_id = box_input->nhbr_ids[RIGHT][nhbr];
-            box_data->nhbr_ids[total_nhbr] = nhbr_id;
-            Coord y_max = min(box_input->y_max, bs[nhbr_id].y_max);
-            Coord y_min = max(box_input->y_min, bs[nhbr_id].y_min);
-            box_data->overlaps[total_nhbr] = y_max - y_min;
-            box_data->self_overlap -= y_max - y_min;
-        }
+    /**
+     * Record parse statistics
+     */
+    input->parse_bytes   = buffer->size;
+    input->parse_seconds = secondsSince(parse_before);
+    closeInputBuffer(buffer);
+
+    publishSharedInput(&segment, input);
+    if (cached) {
+        storeCachedInput(&cache_key, input);
     }
+    return input;
+}
+
+/**
+ * {@inheritDoc}
+ */
+AMRInput* parseInput(const char* file_name, Count num_threads) {
+    AMRInput*   input      = loadInput(file_name, num_threads);
+    const char* delta_name = deltaFile();
 
     /**
-     * Clean up
+     * Deltas are applied after the grid is cached/published,
+     * so those always hold the grid as stored
      */
-    for (Count i = 0; i < input->N; ++i) {
-        BoxInput* box_input = &bs[i];
-        for (DIRECTION dir = TOP; dir <= RIGHT; ++dir) {
-            free(box_input->nhbr_ids[dir]);
-        }
+    if (delta_name != NULL) {
+        struct timespec delta_before;
+        clock_gettime(CLOCK_REALTIME, &delta_before);
+        applyDelta(input, delta_name);
+        input->parse_seconds += secondsSince(delta_before);
     }
-    free(bs);
 
+    /**
+     * Boxes are renumbered last (delta ids refer to the grid as stored)
+     */
+    input->order = NULL;
+    ReorderKind kind = reorderKind();
+    if (kind != REORDER_NONE) {
+        struct timespec reorder_before;
+        clock_gettime(CLOCK_REALTIME, &reorder_before);
+        applyOrder(input, computeOrder(input, kind, input->arena));
+        input->parse_seconds += secondsSince(reorder_before);
+    }
     return input;
 }
 
@@ -211,13 +171,26 @@ AMRInput* parseInput() {
  * {@inheritDoc}
  */
 void destroyInput(AMRInput* input) {
-    for (Count i = 0; i < input->N; ++i) {
-        free(input->boxes[i].nhbr_ids);
-        free(input->boxes[i].overlaps);
+    if (input->source != NULL) {
+        closeInputBuffer(input->source);
+    }
+    destroyArena(input->arena);
+}
+
+/**
+ * {@inheritDoc}
+ */
+void computeWeightRange(const AMRInput* input, float affect_rate, Count start, Count end,
+                        Weight* diag_weights, Weight* nhbr_weights) {
+    for (Count i = start; i < end; ++i) {
+        double scale    = (double) affect_rate / input->perimeters[i];
+        diag_weights[i] = (1 - affect_rate) + scale * input->self_overlaps[i];
+
+        Offset offset = input->offsets[i];
+        for (Count nhbr = 0; nhbr < input->num_nhbrs[i]; ++nhbr) {
+            nhbr_weights[offset + nhbr] = scale * input->overlaps[offset + nhbr];
+        }
     }
-    free(input->boxes);
-    free(input->vals);
-    free(input);
 }
 
 /**
@@ -237,5 +210,8 @@ void displayOutput(AMROutput output) {
     printf("=> time-seconds    %lf\n", output.time_seconds);
     printf("=> clock-seconds   %lf\n", output.clock_seconds);
     printf("=> gettime-seconds %lf\n", output.gettime_seconds);
+    printf("=> parse-seconds   %lf\n", output.parse_seconds);
+    printf("=> parse-MBps      %lf\n", output.parse_bytes / 1000000.0 / output.parse_seconds);
+    printf("=> overlap-seconds %lf\n", output.overlap_seconds);
     printf("========================================\n\n");
 }
@@ -0,0 +1,455 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "adjacency.h"
+#include "arena.h"
+#include "delta.h"
+#include "reader.h"
+
+extern const char* invalid_format;
+
+/**
+ * {@inheritDoc}
+ */
+const char* deltaFile() {
+    const char* file_name = getenv(DELTA_ENV);
+    return ((file_name == NULL) || (*file_name == '\0')) ? NULL : file_name;
+}
+
+/**
+ * Reads the extent and DSV of a changed or added box,
+ * which has to lie on the grid
+ *
+ * @return 1 on success, 0 on malformed input
+ */
+static int readDeltaBox(InputBuffer* buffer, const AMRInput* input, DeltaOp* op) {
+    Coord y, x, height, width;
+    if (!readCoord(buffer, &y) || !readCoord(buffer, &x)
+        || !readCoord(buffer, &height) || !readCoord(buffer, &width)
+        || !readDSV(buffer, &op->val)) {
+        return 0;
+    }
+    if ((height == 0) || (width == 0) || (y + height > input->rows) || (x + width > input->cols)) {
+        return 0;
+    }
+    op->bounds = (BoxBounds) { x, x + width, y, y + height };
+    return 1;
+}
+
+/**
+ * Reads all records of a delta file, assigning ids to added boxes
+ *
+ * @param num_ops location to store the number of records
+ * @return the records (to be freed by the caller)
+ */
+static DeltaOp* readDeltaOps(InputBuffer* buffer, const AMRInput* input, Count* num_ops) {
+    if (!readKeyword(buffer, DELTA_KEYWORD)) {
+        fprintf(stderr, "%s", invalid_format);
+        exit(1);
+    }
+
+    Count    capacity  = 64;
+    Count    count     = 0;
+    Count    num_boxes = input->N;
+    DeltaOp* ops       = malloc(capacity * sizeof(*ops));
+    while (!readKeyword(buffer, "-1")) {
+        if (count == capacity) {
+            capacity *= 2;
+            ops       = realloc(ops, capacity * sizeof(*ops));
+        }
+        DeltaOp* op = &ops[count++];
+
+        int valid = 0;
+        if (readKeyword(buffer, "change")) {
+            op->kind = DELTA_CHANGE;
+            valid    = readCount(buffer, &op->id) && (op->id < num_boxes)
+                    && readDeltaBox(buffer, input, op);
+        } else if (readKeyword(buffer, "add")) {
+            op->kind = DELTA_ADD;
+            op->id   = num_boxes++;
+            valid    = readDeltaBox(buffer, input, op);
+        } else if (readKeyword(buffer, "remove")) {
+            op->kind = DELTA_REMOVE;
+            valid    = readCount(buffer, &op->id) && (op->id < num_boxes);
+        } else if (readKeyword(buffer, "dsv")) {
+            op->kind = DELTA_DSV;
+            valid    = readCount(buffer, &op->id) && (op->id < num_boxes)
+                    && readDSV(buffer, &op->val);
+        }
+        if (!valid) {
+            fprintf(stderr, "%s", invalid_format);
+            exit(1);
+        }
+    }
+    *num_ops = count;
+    return ops;
+}
+
+/**
+ * Orders edges by line only
+ */
+static int compareLines(const void* a, const void* b) {
+    const BoxEdge* edge_a = (const BoxEdge*) a;
+    const BoxEdge* edge_b = (const BoxEdge*) b;
+    if (edge_a->line != edge_b->line) {
+        return (edge_a->line < edge_b->line) ? -1 : 1;
+    }
+    return 0;
+}
+
+/**
+ * Checks whether any of the (line-sorted) edges lies on {@code line}
+ * and overlaps [{@code lo}, {@code hi}) with positive length
+ */
+static int touchesEdges(const BoxEdge* edges, Count num_edges, Coord line, Coord lo, Coord hi) {
+    Count first = 0;
+    Count last  = num_edges;
+    while (first < last) {
+        Count middle = first + (last - first) / 2;
+        if (edges[middle].line < line) {
+            first = middle + 1;
+        } else {
+            last = middle;
+        }
+    }
+    for (Count i = first; (i < num_edges) && (edges[i].line == line); ++i) {
+        if (min(hi, edges[i].hi) > max(lo, edges[i].lo)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Length of the edge shared by two neighboring boxes
+ */
+static Coord sharedEdge(const BoxBounds* a, const BoxBounds* b) {
+    if ((a->y_max == b->y_min) || (a->y_min == b->y_max)) {
+        int overlap = min(a->x_max, b->x_max) - max(a->x_min, b->x_min);
+        if (overlap > 0) {
+            return overlap;
+        }
+    }
+    return min(a->y_max, b->y_max) - max(a->y_min, b->y_min);
+}
+
+/**
+ * Checks whether two boxes overlap by more than an edge
+ */
+static int interiorsIntersect(const BoxBounds* a, const BoxBounds* b) {
+    return (min(a->x_max, b->x_max) > max(a->x_min, b->x_min))
+        && (min(a->y_max, b->y_max) > max(a->y_min, b->y_min));
+}
+
+/**
+ * {@inheritDoc}
+ */
+void applyDelta(AMRInput* input, const char* file_name) {
+    InputBuffer* buffer = openInputBuffer(file_name);
+    Count        num_ops;
+    DeltaOp*     ops = readDeltaOps(buffer, input, &num_ops);
+    closeInputBuffer(buffer);
+
+    /**
+     * DSV-only deltas leave the topology alone
+     */
+    int topology = 0;
+    for (Count op = 0; op < num_ops; ++op) {
+        topology |= (ops[op].kind != DELTA_DSV);
+    }
+    if (!topology) {
+        for (Count op = 0; op < num_ops; ++op) {
+            input->vals[ops[op].id] = ops[op].val;
+        }
+        free(ops);
+        return;
+    }
+
+    Arena* arena   = input->arena;
+    Arena* scratch = createArena(ARENA_BLOCK_SIZE);
+
+    /**
+     * Extents and DSVs of all boxes, old and added,
+     * as of the end of the delta
+     */
+    Count num_old   = input->N;
+    Count num_added = 0;
+    for (Count op = 0; op < num_ops; ++op) {
+        num_added += (ops[op].kind == DELTA_ADD);
+    }
+    Count      num_boxes = num_old + num_added;
+    BoxBounds* bounds    = arenaAlloc(scratch, num_boxes * sizeof(*bounds));
+    DSV*       vals      = arenaAlloc(scratch, num_boxes * sizeof(*vals));
+    memcpy(bounds, input->bounds, num_old * sizeof(*bounds));
+    memcpy(vals, input->vals, num_old * sizeof(*vals));
+
+    /**
+     * Boxes whose old rows have to go are pooled with their old
+     * neighbors (before any extents change)
+     */
+    unsigned char* state = arenaAlloc(scratch, num_boxes * sizeof(*state));
+    Count*         pool  = arenaAlloc(scratch, num_boxes * sizeof(*pool));
+    Count          num_pool    = 0;
+    Count          num_removed = 0;
+    memset(state, 0, num_boxes * sizeof(*state));
+    for (Count op = 0; op < num_ops; ++op) {
+        Count id = ops[op].id;
+        if ((ops[op].kind == DELTA_CHANGE || ops[op].kind == DELTA_REMOVE) && (id < num_old)) {
+            const Count* nhbr_ids = &input->nhbr_ids[input->offsets[id]];
+            for (Count nhbr = 0; nhbr < input->num_nhbrs[id]; ++nhbr) {
+                if (!(state[nhbr_ids[nhbr]] & DELTA_POOL)) {
+                    state[nhbr_ids[nhbr]] |= DELTA_POOL;
+                    pool[num_pool++]       = nhbr_ids[nhbr];
+                }
+            }
+        }
+    }
+
+    /**
+     * Apply the records in order
+     */
+    for (Count op = 0; op < num_ops; ++op) {
+        Count id = ops[op].id;
+        switch (ops[op].kind) {
+            case DELTA_CHANGE:
+            case DELTA_ADD:
+                bounds[id] = ops[op].bounds;
+                vals[id]   = ops[op].val;
+                state[id] |= (ops[op].kind == DELTA_ADD) ? DELTA_ADDED : DELTA_CHANGED;
+                if (!(state[id] & DELTA_POOL)) {
+                    state[id]       |= DELTA_POOL;
+                    pool[num_pool++] = id;
+                }
+                break;
+            case DELTA_REMOVE:
+                num_removed += !(state[id] & DELTA_REMOVED);
+                state[id]   |= DELTA_REMOVED;
+                break;
+            case DELTA_DSV:
+                vals[id] = ops[op].val;
+                break;
+        }
+    }
+    free(ops);
+
+    /**
+     * Boxes touching a new extent join the pool: the edges of the moved
+     * boxes are sorted by line, then every box looks its edges up
+     */
+    BoxEdge* horiz     = arenaAlloc(scratch, 2 * num_pool * sizeof(*horiz));
+    BoxEdge* vert      = arenaAlloc(scratch, 2 * num_pool * sizeof(*vert));
+    Count    num_edges = 0;
+    for (Count p = 0; p < num_pool; ++p) {
+        Count id = pool[p];
+        if ((state[id] & (DELTA_CHANGED | DELTA_ADDED)) && !(state[id] & DELTA_REMOVED)) {
+            const BoxBounds* box_bounds = &bounds[id];
+            horiz[num_edges]     = (BoxEdge) { box_bounds->y_max, box_bounds->x_min, box_bounds->x_max, id, 0 };
+            horiz[num_edges + 1] = (BoxEdge) { box_bounds->y_min, box_bounds->x_min, box_bounds->x_max, id, 1 };
+            vert[num_edges]      = (BoxEdge) { box_bounds->x_max, box_bounds->y_min, box_bounds->y_max, id, 0 };
+            vert[num_edges + 1]  = (BoxEdge) { box_bounds->x_min, box_bounds->y_min, box_bounds->y_max, id, 1 };
+            num_edges += 2;
+        }
+    }
+    qsort(horiz, num_edges, sizeof(*horiz), &compareLines);
+    qsort(vert, num_edges, sizeof(*vert), &compareLines);
+    for (Count i = 0; (i < num_boxes) && (num_edges > 0); ++i) {
+        if (state[i] & (DELTA_POOL | DELTA_REMOVED)) {
+            continue;
+        }
+        const BoxBounds* box_bounds = &bounds[i];
+        if (touchesEdges(horiz, num_edges, box_bounds->y_min, box_bounds->x_min, box_bounds->x_max)
+            || touchesEdges(horiz, num_edges, box_bounds->y_max, box_bounds->x_min, box_bounds->x_max)
+            || touchesEdges(vert, num_edges, box_bounds->x_min, box_bounds->y_min, box_bounds->y_max)
+            || touchesEdges(vert, num_edges, box_bounds->x_max, box_bounds->y_min, box_bounds->y_max)) {
+            state[i]        |= DELTA_POOL;
+            pool[num_pool++] = i;
+        }
+    }
+
+    /**
+     * Sweep the pool (without removed boxes) on its own
+     */
+    Count  live       = 0;
+    Count* pool_index = arenaAlloc(scratch, num_boxes * sizeof(*pool_index));
+    for (Count p = 0; p < num_pool; ++p) {
+        if (!(state[pool[p]] & DELTA_REMOVED)) {
+            pool_index[pool[p]] = live;
+            pool[live++]        = pool[p];
+        }
+    }
+    num_pool = live;
+
+    GridRecords* records = arenaAlloc(scratch, sizeof(*records));
+    records->N         = num_pool;
+    records->bounds    = arenaAlloc(scratch, num_pool * sizeof(*records->bounds));
+    records->dir_nhbrs = arenaAlloc(scratch, NUM_DIR * num_pool * sizeof(*records->dir_nhbrs));
+    records->offsets   = arenaAlloc(scratch, (num_pool + 1) * sizeof(*records->offsets));
+    for (Count p = 0; p < num_pool; ++p) {
+        records->bounds[p] = bounds[pool[p]];
+    }
+    buildAdjacency(records, scratch, scratch);
+
+    /**
+     * New rows of the pool: moved boxes take all of their swept neighbors,
+     * the rest keep their unmoved old neighbors and gain their moved swept
+     * ones. At most the old plus the swept neighbors, so rows are laid out
+     * for that many.
+     */
+    Offset* pool_offsets = arenaAlloc(scratch, (num_pool + 1) * sizeof(*pool_offsets));
+    Count*  pool_nhbrs   = arenaAlloc(scratch, num_pool * sizeof(*pool_nhbrs));
+    Coord*  pool_selfs   = arenaAlloc(scratch, num_pool * sizeof(*pool_selfs));
+    pool_offsets[0] = 0;
+    for (Count p = 0; p < num_pool; ++p) {
+        Count id   = pool[p];
+        Count room = records->offsets[p + 1] - records->offsets[p];
+        if ((id < num_old) && !(state[id] & (DELTA_CHANGED | DELTA_ADDED))) {
+            room += input->num_nhbrs[id];
+        }
+        pool_offsets[p + 1] = pool_offsets[p] + room;
+    }
+    Count* pool_ids      = arenaAlloc(scratch, pool_offsets[num_pool] * sizeof(*pool_ids));
+    Coord* pool_overlaps = arenaAlloc(scratch, pool_offsets[num_pool] * sizeof(*pool_overlaps));
+
+    for (Count p = 0; p < num_pool; ++p) {
+        Count            id         = pool[p];
+        const BoxBounds* box_bounds = &bounds[id];
+        Count*           row_ids    = &pool_ids[pool_offsets[p]];
+        Coord*           row_overs  = &pool_overlaps[pool_offsets[p]];
+        Count            num_nhbrs  = 0;
+
+        if (!(state[id] & (DELTA_CHANGED | DELTA_ADDED))) {
+            const Count* nhbr_ids = &input->nhbr_ids[input->offsets[id]];
+            const Coord* overlaps = &input->overlaps[input->offsets[id]];
+            for (Count nhbr = 0; nhbr < input->num_nhbrs[id]; ++nhbr) {
+                if (!(state[nhbr_ids[nhbr]] & (DELTA_CHANGED | DELTA_REMOVED))) {
+                    row_ids[num_nhbrs]   = nhbr_ids[nhbr];
+                    row_overs[num_nhbrs] = overlaps[nhbr];
+                    ++num_nhbrs;
+                }
+            }
+        }
+        for (Offset swept = records->offsets[p]; swept < records->offsets[p + 1]; ++swept) {
+            Count nhbr_id = pool[records->nhbr_ids[swept]];
+            if (interiorsIntersect(box_bounds, &bounds[nhbr_id])) {
+                fprintf(stderr, "Error: delta leaves box "COUNT_SPEC" overlapping its neighbors\n", id);
+                exit(1);
+            }
+            if ((state[id] | state[nhbr_id]) & (DELTA_CHANGED | DELTA_ADDED)) {
+                row_ids[num_nhbrs]   = nhbr_id;
+                row_overs[num_nhbrs] = sharedEdge(box_bounds, &bounds[nhbr_id]);
+                ++num_nhbrs;
+            }
+        }
+
+        /**
+         * Boxes that overlap share more than their perimeter
+         * with their neighbors, which no valid grid does
+         */
+        Coord perimeter = 2 * ((box_bounds->x_max - box_bounds->x_min)
+                             + (box_bounds->y_max - box_bounds->y_min));
+        unsigned long long shared = 0;
+        for (Count nhbr = 0; nhbr < num_nhbrs; ++nhbr) {
+            shared += row_overs[nhbr];
+        }
+        if (shared > perimeter) {
+            fprintf(stderr, "Error: delta leaves box "COUNT_SPEC" overlapping its neighbors\n", id);
+            exit(1);
+        }
+        Coord self_overlap = perimeter - shared;
+        pool_nhbrs[p] = num_nhbrs;
+        pool_selfs[p] = self_overlap;
+    }
+
+    /**
+     * Ids after compaction: every hole below the new end
+     * is filled with the highest live box
+     */
+    Count* new_ids = arenaAlloc(scratch, num_boxes * sizeof(*new_ids));
+    Count* old_ids = arenaAlloc(scratch, num_boxes * sizeof(*old_ids));
+    for (Count i = 0; i < num_boxes; ++i) {
+        new_ids[i] = i;
+        old_ids[i] = i;
+    }
+    Count top = num_boxes;
+    for (Count hole = 0; (hole < top) && (num_removed > 0); ++hole) {
+        if (!(state[hole] & DELTA_REMOVED)) {
+            continue;
+        }
+        while ((top > hole + 1) && (state[top - 1] & DELTA_REMOVED)) {
+            --top;
+        }
+        if (top == hole + 1) {
+            break;
+        }
+        Count moved = --top;
+        new_ids[moved] = hole;
+        old_ids[hole]  = moved;
+    }
+
+    /**
+     * Re-pack the CSR arrays in the new id order, taking the
+     * pool's rows from above and every other row as it was
+     */
+    Count   N             = num_boxes - num_removed;
+    Coord*  perimeters    = arenaAlloc(arena, N * sizeof(*perimeters));
+    Count*  num_nhbrs     = arenaAlloc(arena, N * sizeof(*num_nhbrs));
+    Offset* offsets       = arenaAlloc(arena, N * sizeof(*offsets));
+    Coord*  self_overlaps = arenaAlloc(arena, N * sizeof(*self_overlaps));
+    Offset  total_nhbrs   = 0;
+    for (Count i = 0; i < N; ++i) {
+        Count id = old_ids[i];
+        if (state[id] & DELTA_POOL) {
+            const BoxBounds* box_bounds = &bounds[id];
+            perimeters[i]    = 2 * ((box_bounds->x_max - box_bounds->x_min)
+                                  + (box_bounds->y_max - box_bounds->y_min));
+            num_nhbrs[i]     = pool_nhbrs[pool_index[id]];
+            self_overlaps[i] = pool_selfs[pool_index[id]];
+        } else {
+            perimeters[i]    = input->perimeters[id];
+            num_nhbrs[i]     = input->num_nhbrs[id];
+            self_overlaps[i] = input->self_overlaps[id];
+        }
+        offsets[i]   = total_nhbrs;
+        total_nhbrs += num_nhbrs[i];
+    }
+
+    Count* nhbr_ids = arenaAlloc(arena, total_nhbrs * sizeof(*nhbr_ids));
+    Coord* overlaps = arenaAlloc(arena, total_nhbrs * sizeof(*overlaps));
+    for (Count i = 0; i < N; ++i) {
+        Count        id = old_ids[i];
+        const Count* row_ids;
+        const Coord* row_overs;
+        if (state[id] & DELTA_POOL) {
+            row_ids   = &pool_ids[pool_offsets[pool_index[id]]];
+            row_overs = &pool_overlaps[pool_offsets[pool_index[id]]];
+        } else {
+            row_ids   = &input->nhbr_ids[input->offsets[id]];
+            row_overs = &input->overlaps[input->offsets[id]];
+        }
+        for (Count nhbr = 0; nhbr < num_nhbrs[i]; ++nhbr) {
+            nhbr_ids[offsets[i] + nhbr] = new_ids[row_ids[nhbr]];
+        }
+        memcpy(&overlaps[offsets[i]], row_overs, num_nhbrs[i] * sizeof(*overlaps));
+    }
+
+    BoxBounds* final_bounds = arenaAlloc(arena, N * sizeof(*final_bounds));
+    DSV*       final_vals   = arenaAlloc(arena, N * sizeof(*final_vals));
+    for (Count i = 0; i < N; ++i) {
+        final_bounds[i] = bounds[old_ids[i]];
+        final_vals[i]   = vals[old_ids[i]];
+    }
+
+    input->N             = N;
+    input->perimeters    = perimeters;
+    input->num_nhbrs     = num_nhbrs;
+    input->offsets       = offsets;
+    input->self_overlaps = self_overlaps;
+    input->total_nhbrs   = total_nhbrs;
+    input->nhbr_ids      = nhbr_ids;
+    input->overlaps      = overlaps;
+    input->bounds        = final_bounds;
+    input->vals          = final_vals;
+
+    destroyArena(scratch);
+}
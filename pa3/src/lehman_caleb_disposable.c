@@ -1,25 +1,30 @@
+#include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 #include <omp.h>
 
 #include "amr.h"
+#include "arena.h"
 #include "common.h"
 
 const char* usage = "\
-Usage: disposable [affect-rate] [epsilon] [num-threads]\n\
+Usage: disposable [affect-rate] [epsilon] [num-threads] [test-file | --stdin]\n\
 \n\
 affect-rate: float value controlling the effect of neighboring boxes\n\
 epsilon    : float value determining the cutoff for convergence\n\
              should be non-negative\n\
 num-threads: number of threads to spawn for computation\n\
-             should be positive\n";
+             should be positive\n\
+test-file  : test file with input to AMR problem, memory-mapped\n\
+--stdin    : read input from stdin instead (the default when omitted)\n";
 
 int main(int argc, char** argv) {
     /**
      * Parse command-line arguments
      */
-    if (argc != 4) {
+    if ((argc != 4) && (argc != 5)) {
         printf("%s", usage);
         exit(1);
     }
@@ -32,10 +37,15 @@ int main(int argc, char** argv) {
         exit(1);
     }
 
+    const char* test_file = NULL;
+    if ((argc == 5) && (strcmp(argv[4], "--stdin") != 0)) {
+        test_file = argv[4];
+    }
+
     /**
-     * Parse input data from standard input
+     * Parse input data from test file (or standard input)
      */
-    AMRInput* input = parseInput();
+    AMRInput* input = parseInput(test_file, num_threads);
 
     /**
      * Run and collect timing information
@@ -86,38 +96,57 @@ AMROutput run(AMRInput* input, float affect_rate, float epsilon, Count num_threa
      * Repeat until convergence
      */
     AMRMaxMin max_min = getMaxMin(input);
-    DSV* updated_vals = malloc(input->N * sizeof(*updated_vals));
+    DSV* updated_vals = arenaAlloc(input->arena, input->N * sizeof(*updated_vals));
+
+    /**
+     * Fold the coefficients that stay constant for the run into weights
+     */
+    Weight* diag_weights = arenaAlloc(input->arena, input->N * sizeof(*diag_weights));
+    Weight* nhbr_weights = arenaAlloc(input->arena, input->total_nhbrs * sizeof(*nhbr_weights));
+    computeWeightRange(input, affect_rate, 0, input->N, diag_weights, nhbr_weights);
+
+    /**
+     * updated_vals and input->vals are swapped during
+     * execution, need to remember the original DSVs
+     */
+    DSV* orig_vals = input->vals;
 
     unsigned long iter;
-    for (iter = 0; (max_min.max - max_min.min) / max_min.max > epsilon; ++iter, max_min = getMaxMin(input)) {
+    for (iter = 0; (max_min.max - max_min.min) / max_min.max > epsilon; ++iter) {
         /**
-         * For each box
+         * For each box, tracking the extremal updated DSVs
+         * on the way (combined across threads by the reduction)
          */
+        DSV next_max = -HUGE_VAL;
+        DSV next_min = HUGE_VAL;
         #pragma omp parallel num_threads(num_threads)
         {
             #ifdef _OPENMP
             #pragma omp single nowait
-            if (omp_get_num_threads() != num_threads) {
+            if ((Count) omp_get_num_threads() != num_threads) {
                 printf("Unable to create %d threads (created %d)\n", num_threads, omp_get_num_threads());
                 exit(1);
             }
             #endif
 
-            #pragma omp for schedule(static)
+            #pragma omp for schedule(static) reduction(max: next_max) reduction(min: next_min)
             for (Count i = 0; i < input->N; ++i) {
-                BoxData* box = &input->boxes[i];
+                const Count*  nhbr_ids = &input->nhbr_ids[input->offsets[i]];
+                const Weight* weights  = &nhbr_weights[input->offsets[i]];
                 /**
                  * Compute updated DSV
                  */
-                updated_vals[i] = box->self_overlap * input->vals[i];
-                for (Count nhbr = 0; nhbr < box->num_nhbrs; ++nhbr) {
-                    updated_vals[i] += box->overlaps[nhbr] * input->vals[box->nhbr_ids[nhbr]];
+                DSV updated = diag_weights[i] * input->vals[i];
+                for (Count nhbr = 0; nhbr < input->num_nhbrs[i]; ++nhbr) {
+                    updated += weights[nhbr] * input->vals[nhbr_ids[nhbr]];
                 }
-                updated_vals[i] /= box->perimeter;
-                updated_vals[i] = input->vals[i] * (1 - affect_rate)
-                    + updated_vals[i] * affect_rate;
+                updated_vals[i] = updated;
+                next_max = (updated > next_max) ? updated : next_max;
+                next_min = (updated < next_min) ? updated : next_min;
             }
         }
+        max_min.max = next_max;
+        max_min.min = next_min;
 
         /**
          * Commit updated DSVs
@@ -127,14 +156,17 @@ AMROutput run(AMRInput* input, float affect_rate, float epsilon, Count num_threa
         updated_vals = temp;
     }
 
-    free(updated_vals);
+    input->vals = orig_vals;
 
-    AMROutput result;
+    AMROutput result = { 0 };
     result.affect_rate = affect_rate;
     result.epsilon     = epsilon;
     result.num_threads = num_threads;
     result.iterations  = iter;
     result.max         = max_min.max;
     result.min         = max_min.min;
+    result.parse_bytes   = input->parse_bytes;
+    result.parse_seconds   = input->parse_seconds;
+    result.overlap_seconds = input->overlap_seconds;
     return result;
 }
@@ -1,25 +1,41 @@
+#include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 #include <omp.h>
 
 #include "amr.h"
+#include "arena.h"
+#include "color.h"
 #include "common.h"
+#include "convergence.h"
+
+/**
+ * A thread's extremal updated DSVs, padded to whole cache lines so the
+ * threads writing their own entries never share one
+ */
+typedef union PaddedMaxMin {
+    AMRMaxMin range;
+    char      pad[((sizeof(AMRMaxMin) + CACHE_LINE - 1) / CACHE_LINE) * CACHE_LINE];
+} PaddedMaxMin;
 
 const char* usage = "\
-Usage: persistent [affect-rate] [epsilon] [num-threads]\n\
+Usage: persistent [affect-rate] [epsilon] [num-threads] [test-file | --stdin]\n\
 \n\
 affect-rate: float value controlling the effect of neighboring boxes\n\
 epsilon    : float value determining the cutoff for convergence\n\
              should be non-negative\n\
 num-threads: number of threads to spawn for computation\n\
-             should be positive\n";
+             should be positive\n\
+test-file  : test file with input to AMR problem, memory-mapped\n\
+--stdin    : read input from stdin instead (the default when omitted)\n";
 
 int main(int argc, char** argv) {
     /**
      * Parse command-line arguments
      */
-    if (argc != 4) {
+    if ((argc != 4) && (argc != 5)) {
         printf("%s", usage);
         exit(1);
     }
@@ -32,10 +48,15 @@ int main(int argc, char** argv) {
         exit(1);
     }
 
+    const char* test_file = NULL;
+    if ((argc == 5) && (strcmp(argv[4], "--stdin") != 0)) {
+        test_file = argv[4];
+    }
+
     /**
-     * Parse input data from standard input
+     * Parse input data from test file (or standard input)
      */
-    AMRInput* input = parseInput();
+    AMRInput* input = parseInput(test_file, num_threads);
 
     /**
      * Run and collect timing information
@@ -73,6 +94,20 @@ int main(int argc, char** argv) {
     return 0;
 }
 
+/**
+ * Updated DSV of box {@code i} from the weights (see {@code computeWeightRange()})
+ */
+static inline DSV updateBox(const AMRInput* input, const Weight* diag_weights,
+                            const Weight* nhbr_weights, const DSV* vals, Count i) {
+    const Count*  nhbr_ids = &input->nhbr_ids[input->offsets[i]];
+    const Weight* weights  = &nhbr_weights[input->offsets[i]];
+    DSV updated = diag_weights[i] * vals[i];
+    for (Count nhbr = 0; nhbr < input->num_nhbrs[i]; ++nhbr) {
+        updated += weights[nhbr] * vals[nhbr_ids[nhbr]];
+    }
+    return updated;
+}
+
 /**
  * {@inheritDoc}
  */
@@ -82,18 +117,45 @@ AMROutput run(AMRInput* input, float affect_rate, float epsilon, Count num_threa
         exit(1);
     }
 
+    /**
+     * Renumber the grid by color class if the Gauss-Seidel
+     * update is enabled, which updates a single buffer in place
+     */
+    ColorClasses* colors = NULL;
+    if (gaussSeidelEnabled()) {
+        colors = colorBoxes(input);
+    }
+
     /**
      * Repeat until convergence
      */
     AMRMaxMin max_min = getMaxMin(input);
-    DSV* updated_vals = malloc(input->N * sizeof(*updated_vals));
+    DSV* updated_vals = NULL;
+    if (colors == NULL) {
+        updated_vals = arenaAlloc(input->arena, input->N * sizeof(*updated_vals));
+    }
+
+    /**
+     * Fold the coefficients that stay constant for the run into weights
+     */
+    Weight* diag_weights = arenaAlloc(input->arena, input->N * sizeof(*diag_weights));
+    Weight* nhbr_weights = arenaAlloc(input->arena, input->total_nhbrs * sizeof(*nhbr_weights));
+    computeWeightRange(input, affect_rate, 0, input->N, diag_weights, nhbr_weights);
+
+    /**
+     * Each thread's extremal updated DSVs, combined at every check
+     */
+    PaddedMaxMin* partials = aligned_alloc(CACHE_LINE, num_threads * sizeof(*partials));
+
+    ConvergenceCheck check;
+    initConvergenceCheck(&check, input, affect_rate, max_min);
 
     unsigned long total_iters = 0;
     #pragma omp parallel num_threads(num_threads)
     {
         #ifdef _OPENMP
         #pragma omp single nowait
-        if (omp_get_num_threads() != num_threads) {
+        if ((Count) omp_get_num_threads() != num_threads) {
             printf("Unable to create %d threads (created %d)\n", num_threads, omp_get_num_threads());
             exit(1);
         }
@@ -108,48 +170,91 @@ AMROutput run(AMRInput* input, float affect_rate, float epsilon, Count num_threa
             ? input->N
             : (tid + 1) * (input->N / num_threads);
 
-        unsigned long iter;
-        for (iter = 0; (max_min.max - max_min.min) / max_min.max > epsilon; ++iter) {
+        /**
+         * Every thread swaps its own pointers, so a barrier (no thread
+         * still reading the old DSVs) is enough to commit, and only the
+         * iterations checked for convergence take a second one. Each
+         * thread keeps its own copy of the next check, as the single
+         * thread moves it while the others test it.
+         */
+        DSV*          vals       = input->vals;
+        DSV*          next_vals  = updated_vals;
+        unsigned long iter       = 0;
+        unsigned long next_check = check.next_check;
+        while ((max_min.max - max_min.min) / max_min.max > epsilon) {
             /**
-             * For each box
+             * For each box, tracking the extremal updated DSVs on the way
              */
-            for (Count i = start; i < end; ++i) {
-                BoxData* box = &input->boxes[i];
+            AMRMaxMin range = { -HUGE_VAL, HUGE_VAL };
+            if (colors != NULL) {
                 /**
-                 * Compute updated DSV
+                 * Gauss-Seidel: each color class split over the threads and
+                 * updated in place (it only reads DSVs of other classes),
+                 * with a barrier before the next class reads it
                  */
-                updated_vals[i] = box->self_overlap * input->vals[i];
-                for (Count nhbr = 0; nhbr < box->num_nhbrs; ++nhbr) {
-                    updated_vals[i] += box->overlaps[nhbr] * input->vals[box->nhbr_ids[nhbr]];
+                for (Count c = 0; c < colors->num_colors; ++c) {
+                    if (c > 0) {
+                        #pragma omp barrier
+                    }
+                    #pragma omp for schedule(static) nowait
+                    for (Count i = colors->starts[c]; i < colors->starts[c + 1]; ++i) {
+                        DSV updated = updateBox(input, diag_weights, nhbr_weights, vals, i);
+                        vals[i]   = updated;
+                        range.max = (updated > range.max) ? updated : range.max;
+                        range.min = (updated < range.min) ? updated : range.min;
+                    }
                 }
-                updated_vals[i] /= box->perimeter;
-                updated_vals[i] = input->vals[i] * (1 - affect_rate)
-                    + updated_vals[i] * affect_rate;
-            }
-            #pragma omp barrier
+                partials[tid].range = range;
+            } else {
+                for (Count i = start; i < end; ++i) {
+                    DSV updated = updateBox(input, diag_weights, nhbr_weights, vals, i);
+                    next_vals[i] = updated;
+                    range.max = (updated > range.max) ? updated : range.max;
+                    range.min = (updated < range.min) ? updated : range.min;
+                }
+                partials[tid].range = range;
 
-            #pragma omp single
-            {
                 /**
                  * Commit updated DSVs
                  */
-                DSV* temp = input->vals;
-                input->vals = updated_vals;
-                updated_vals = temp;
+                DSV* temp = vals;
+                vals      = next_vals;
+                next_vals = temp;
+            }
+            ++iter;
+            #pragma omp barrier
+            if (iter < next_check) {
+                continue;
+            }
 
-                total_iters = iter + 1;
-                max_min = getMaxMin(input);
+            #pragma omp single
+            {
+                AMRMaxMin combined = partials[0].range;
+                for (Count other = 1; other < num_threads; ++other) {
+                    combined.max = (partials[other].range.max > combined.max) ? partials[other].range.max : combined.max;
+                    combined.min = (partials[other].range.min < combined.min) ? partials[other].range.min : combined.min;
+                }
+                if (!finishCheck(&check, input->N, vals, combined, epsilon, &iter)) {
+                    max_min = combined;
+                }
+                total_iters = iter;
             }
+            iter       = total_iters;
+            next_check = check.next_check;
         }
     }
-    free(updated_vals);
+    destroyConvergenceCheck(&check);
+    free(partials);
 
-    AMROutput result;
+    AMROutput result = { 0 };
     result.affect_rate = affect_rate;
     result.epsilon     = epsilon;
     result.num_threads = num_threads;
     result.iterations  = total_iters;
     result.max         = max_min.max;
     result.min         = max_min.min;
+    result.parse_bytes   = input->parse_bytes;
+    result.parse_seconds   = input->parse_seconds;
+    result.overlap_seconds = input->overlap_seconds;
     return result;
 }
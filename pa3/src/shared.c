@@ -0,0 +1,124 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "amrb.h"
+#include "cache.h"
+#include "shared.h"
+
+/**
+ * Maps a published segment, returns {@code NULL} if it is incomplete
+ * (i.e. its publisher died while writing it)
+ */
+static InputBuffer* mapSegment(int fd, size_t size) {
+    void* data = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    if (data == MAP_FAILED) {
+        perror("mmap");
+        exit(1);
+    }
+
+    InputBuffer* buffer = malloc(sizeof(*buffer));
+    buffer->data   = data;
+    buffer->pos    = buffer->data;
+    buffer->end    = buffer->data + size;
+    buffer->size   = size;
+    buffer->mapped = 1;
+    buffer->stream = NULL;
+
+    const AMRBHeader* header = (const AMRBHeader*) buffer->data;
+    if (!isBinaryInput(buffer)
+        || (header->num_sections != AMRB_NUM_SECTIONS)
+        || (header->section_offsets[AMRB_VALS] + header->section_bytes[AMRB_VALS] > size)
+    ) {
+        closeInputBuffer(buffer);
+        return NULL;
+    }
+    return buffer;
+}
+
+/**
+ * {@inheritDoc}
+ */
+AMRInput* attachSharedInput(const InputBuffer* buffer, SharedSegment* segment) {
+    segment->fd = -1;
+    const char* enabled = getenv(SHARED_TOPOLOGY_ENV);
+    if ((enabled == NULL) || (*enabled == '\0') || (strcmp(enabled, "0") == 0)
+        || (buffer->stream != NULL)) {
+        return NULL;
+    }
+    snprintf(segment->name, sizeof(segment->name), "/amr-%016llx-%016llx-%zu%zu%zu%zu",
+             (unsigned long long) hashBytes(buffer->data, buffer->size),
+             (unsigned long long) buffer->size,
+             sizeof(Count), sizeof(Offset), sizeof(Coord), sizeof(DSV));
+
+    for (int retry = 0; retry < SHARED_RETRIES; ++retry) {
+        /**
+         * First process publishes
+         */
+        int fd = shm_open(segment->name, O_RDWR | O_CREAT | O_EXCL, 0644);
+        if (fd >= 0) {
+            flock(fd, LOCK_EX);
+            segment->fd = fd;
+            return NULL;
+        }
+        if (errno != EEXIST) {
+            fprintf(stderr, "Warning: could not create shared segment %s: %s\n", segment->name, strerror(errno));
+            return NULL;
+        }
+
+        /**
+         * Everyone else waits for the publisher, then attaches
+         */
+        fd = shm_open(segment->name, O_RDONLY, 0);
+        if (fd < 0) {
+            continue;
+        }
+        flock(fd, LOCK_SH);
+        struct stat info;
+        if ((fstat(fd, &info) != 0) || (info.st_size == 0)) {
+            close(fd);
+            usleep(SHARED_RETRY_DELAY);
+            continue;
+        }
+        InputBuffer* shared = mapSegment(fd, info.st_size);
+        close(fd);
+        if (shared == NULL) {
+            shm_unlink(segment->name);
+            continue;
+        }
+        return loadBinaryInput(shared);
+    }
+
+    /**
+     * Segment was created but never written, start over
+     */
+    fprintf(stderr, "Warning: shared segment %s was abandoned, parsing privately\n", segment->name);
+    shm_unlink(segment->name);
+    return NULL;
+}
+
+/**
+ * {@inheritDoc}
+ */
+void publishSharedInput(SharedSegment* segment, AMRInput* input) {
+    if (segment->fd < 0) {
+        return;
+    }
+    FILE* file = fdopen(segment->fd, "wb");
+    if (file == NULL) {
+        perror(segment->name);
+        exit(1);
+    }
+    writeBinaryStream(input, file);
+    if (fclose(file) != 0) {
+        perror(segment->name);
+        exit(1);
+    }
+    segment->fd = -1;
+}
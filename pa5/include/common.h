@@ -1,5 +1,7 @@
 #pragma once
 
+#include <stddef.h>
+#include <stdio.h>
 #include <time.h>
 
 typedef unsigned int Count;
@@ -12,6 +14,47 @@ typedef double       DSV;
 #define COORD_MPI_TYPE MPI_UNSIGNED
 #define DSV_MPI_TYPE MPI_DOUBLE
 
+/**
+ * Offsets into the per-neighbor arrays and neighbor totals.
+ * 32-bit by default, building with {@code WIDE_OFFSETS=1} (see the Makefile)
+ * makes them 64-bit for grids with 4G or more neighbor entries.
+ * Box ids (and so {@code nhbr_ids}) stay {@code Count}.
+ */
+#ifndef WIDE_OFFSETS
+#define WIDE_OFFSETS 0
+#endif
+#if (WIDE_OFFSETS != 0)
+typedef unsigned long long Offset;
+#define OFFSET_SPEC "%llu"
+#define OFFSET_MPI_TYPE MPI_UNSIGNED_LONG_LONG
+#else
+typedef unsigned int Offset;
+#define OFFSET_SPEC "%u"
+#define OFFSET_MPI_TYPE MPI_UNSIGNED
+#endif
+
+/**
+ * Precomputed update weights (see {@code computeWeightRange()}).
+ * Doubles by default, building with {@code FLOAT_WEIGHTS=1} (see the Makefile)
+ * stores them as floats, halving the per-neighbor weight traffic.
+ * DSVs and the sums over neighbors stay {@code DSV}.
+ */
+#ifndef FLOAT_WEIGHTS
+#define FLOAT_WEIGHTS 0
+#endif
+#if (FLOAT_WEIGHTS != 0)
+typedef float Weight;
+#else
+typedef double Weight;
+#endif
+
+/**
+ * Extent of a box on the grid
+ */
+typedef struct BoxBounds {
+    Coord x_min, x_max, y_min, y_max;
+} BoxBounds;
+
 typedef struct AMRInput {
     /**
      * General parameters:
@@ -28,32 +71,83 @@ typedef struct AMRInput {
      */
     Coord*   perimeters;
     Count*   num_nhbrs;
-    Count*   offsets;
+    Offset*  offsets;
     Coord*   self_overlaps;
-    Count    total_nhbrs;
+    Offset   total_nhbrs;
     Count*   nhbr_ids;
     Coord*   overlaps;
     DSV*     vals;
+
+    /**
+     * Box extents (stored in compiled grids)
+     */
+    BoxBounds* bounds;
+
+    /**
+     * Arena holding this struct and all of its arrays
+     */
+    struct Arena* arena;
+
+    /**
+     * Buffer the topology arrays point into when
+     * loaded from a compiled binary grid, {@code NULL} otherwise
+     */
+    struct InputBuffer* source;
+
+    /**
+     * Parse statistics:
+     *
+     * {@code parse_bytes}   - size of the input in bytes
+     * {@code parse_seconds}   - wall-clock time spent in {@code parseInput()}
+     * {@code overlap_seconds} - part of it spent computing overlaps,
+     *                           0 when the topology was loaded precomputed
+     */
+    size_t parse_bytes;
+    double parse_seconds;
+    double overlap_seconds;
 } AMRInput;
 
 /**
- * Parses Adaptive Mesh Refinement input from stdin.
+ * Parses Adaptive Mesh Refinement input from the given file.
  * Allocates and populates an {@code AMRInput} struct to hold the input.
  * Should be paired with {@code destroyAMRInput}.
  *
+ * @param file_name   path of the input file, or {@code NULL} to read from stdin
+ * @param num_threads number of threads for the overlap stage
  * @return the allocated/populated {@code AMRInput} struct
  */
-AMRInput* parseInput(char* file_name);
+AMRInput* parseInput(const char* file_name, Count num_threads);
 
 /**
  * Destroys input created with {@code parseInput()}.
- * Deallocates all allocations from {@code parseInput()}.
+ * Deallocates all allocations from {@code parseInput()} by releasing its arena.
  * Should be paired with {@code parseInput()}.
  *
  * @param input pointer to {@code AMRInput} returned by {@code parseInput()}
  */
 void destroyInput(AMRInput* input);
 
+/**
+ * Folds the affect rate, perimeter, self-overlap and overlaps of boxes
+ * [{@code start}, {@code end}) into one weight per box and one per neighbor,
+ * so each update is a plain sparse dot product:
+ *
+ * new DSV of box i = diag_weights[i] * vals[i]
+ *                  + sum over its row of nhbr_weights[k] * vals[nhbr_ids[k]]
+ *
+ * diag_weights[i] = (1 - affect_rate) + affect_rate * self_overlaps[i] / perimeters[i]
+ * nhbr_weights[k] = affect_rate * overlaps[k] / perimeters[i]
+ *
+ * @param input        pointer to populated {@code AMRInput} struct
+ * @param affect_rate  affect rate of the run
+ * @param start        first box
+ * @param end          one past the last box
+ * @param diag_weights room for {@code N} weights (only [start, end) is written)
+ * @param nhbr_weights room for {@code total_nhbrs} weights, laid out like {@code nhbr_ids}
+ */
+void computeWeightRange(const AMRInput* input, float affect_rate, Count start, Count end,
+                        Weight* diag_weights, Weight* nhbr_weights);
+
 typedef struct AMRMaxMin {
     DSV max;
     DSV min;
@@ -66,13 +160,10 @@ typedef struct AMRMaxMin {
  */
 static inline AMRMaxMin getMaxMin(AMRInput* input) {
     AMRMaxMin result = { input->vals[0], input->vals[0] };
-    for (int i = 1; i < input->N; ++i) {
+    for (Count i = 1; i < input->N; ++i) {
         DSV val = input->vals[i];
-        if (val > result.max) {
-            result.max = val;
-        } else if (val < result.min) {
-            result.min = val;
-        }
+        result.max = (val > result.max) ? val : result.max;
+        result.min = (val < result.min) ? val : result.min;
     }
     return result;
 }
@@ -92,6 +183,10 @@ typedef struct AMROutput {
     double time_seconds;
     double clock_seconds;
     double gettime_seconds;
+
+    size_t parse_bytes;
+    double parse_seconds;
+    double overlap_seconds;
 } AMROutput;
 
 /**
@@ -115,8 +210,8 @@ static inline int min(int a, int b) { return a < b ? a : b; }
  */
 static inline int max(int a, int b) { return a > b ? a : b; }
 
-static void printDSVs(Count N, DSV* vals) {
-    for (int i = 0; i < N; ++i) {
+static inline void printDSVs(Count N, DSV* vals) {
+    for (Count i = 0; i < N; ++i) {
         printf(DSV_SPEC" ", vals[i]);
     }
     printf("\n");
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "arena.h"
+#include "common.h"
+#include "reader.h"
+
+/**
+ * Environment variable selecting the number of threads
+ * used to parse text grids (defaults to 1, i.e. serial)
+ */
+#define PARSE_THREADS_ENV "AMR_PARSE_THREADS"
+
+/**
+ * Chunks smaller than this are not worth a thread
+ */
+#define MIN_CHUNK_BYTES (64 * 1024)
+
+/**
+ * Neighbor ids first reserved per box while reading (two per side),
+ * the arrays growing geometrically past that
+ */
+#define CHUNK_IDS_PER_BOX (2 * NUM_DIR)
+
+/**
+ * First token of a geometry-only grid, whose records hold just
+ * the box id, geometry and DSV (no neighbor lists):
+ *
+ * geometry
+ * N rows cols
+ * id
+ * y x height width
+ * DSV
+ * ...
+ */
+#define GEOMETRY_KEYWORD "geometry"
+
+#define NUM_DIR 4
+typedef enum { TOP=0, BOTTOM, LEFT, RIGHT } DIRECTION;
+
+/**
+ * Box records of a text grid, as read from the file
+ * (before any overlaps are computed).
+ * {@code bounds}, {@code offsets}, {@code nhbr_ids} and {@code vals} are final arrays,
+ * the rest is only needed while building the {@code AMRInput}.
+ *
+ * {@code bounds}    - N box extents
+ * {@code dir_nhbrs} - 4N neighbor counts, {@code NUM_DIR} per box,
+ *                     indexed by {@code DIRECTION}
+ * {@code offsets}   - N+1 offsets into {@code nhbr_ids}, so box i's
+ *                     neighbors are [offsets[i], offsets[i+1])
+ * {@code nhbr_ids}  - offsets[N] neighbor ids, per box in
+ *                     TOP, BOTTOM, LEFT, RIGHT order (as in the file)
+ * {@code vals}      - N initial DSVs
+ */
+typedef struct GridRecords {
+    Count N;
+    Coord rows, cols;
+
+    BoxBounds* bounds;
+    Count*     dir_nhbrs;
+    Offset*    offsets;
+    Count*     nhbr_ids;
+    DSV*       vals;
+} GridRecords;
+
+/**
+ * Reads the number of parse threads from {@code PARSE_THREADS_ENV}.
+ *
+ * @return the requested number of threads, at least 1
+ */
+Count parseThreads();
+
+/**
+ * Reads all box records of a text grid.
+ * With more than one thread, the input is split into chunks at
+ * box-record boundaries and the chunks are parsed concurrently.
+ * The result is identical to the serial (single-thread) result.
+ * Geometry-only grids (see {@code GEOMETRY_KEYWORD}) are read serially
+ * and their neighbors are found with {@code buildAdjacency()}.
+ * Exits with an error message on malformed input.
+ *
+ * @param buffer      opened {@code InputBuffer} positioned at the start of the grid
+ * @param num_threads number of threads to parse with
+ * @param arena       {@code Arena} for the final arrays
+ * @param scratch     {@code Arena} for everything else, can be released
+ *                    once the {@code AMRInput} is built
+ * @return the populated {@code GridRecords} struct (allocated in {@code scratch})
+ */
+GridRecords* readGridRecords(InputBuffer* buffer, Count num_threads, Arena* arena, Arena* scratch);
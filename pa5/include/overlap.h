@@ -0,0 +1,33 @@
+#pragma once
+
+#include "ingest.h"
+
+/**
+ * Boxes per thread below which the overlap stage
+ * is not worth splitting over threads
+ */
+#define MIN_OVERLAP_BOXES 4096
+
+/**
+ * Work of one overlap thread, boxes [{@code start}, {@code end})
+ */
+typedef struct OverlapTask {
+    const GridRecords* records;
+    Count              start, end;
+    Coord*             overlaps;
+    Coord*             self_overlaps;
+} OverlapTask;
+
+/**
+ * Computes the overlap of every box with each of its neighbors, and the
+ * part of every box's perimeter not shared with any neighbor.
+ * The boxes are split into contiguous ranges with about the same number
+ * of neighbors, one per thread, and each thread writes its range of the
+ * output arrays directly.
+ *
+ * @param records       {@code GridRecords} with bounds and neighbors filled in
+ * @param num_threads   number of threads to use
+ * @param overlaps      room for {@code offsets[N]} overlaps, laid out like {@code nhbr_ids}
+ * @param self_overlaps room for {@code N} self-overlaps
+ */
+void computeOverlaps(const GridRecords* records, Count num_threads, Coord* overlaps, Coord* self_overlaps);
@@ -1,11 +1,13 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 #include <mpi.h>
 #include <omp.h>
 
 #include "amr.h"
 #include "common.h"
+#include "convergence.h"
 
 typedef enum tag {
     ar_tag,
@@ -23,12 +25,18 @@ typedef enum tag {
     run_tag
 } tag;
 
+/**
+ * Most elements sent in one message, as MPI counts are {@code int}s
+ */
+#define MAX_MESSAGE_ELEMENTS (1 << 30)
+
 const char* usage = "\
-Usage: amr [affect-rate] [epsilon] [test-file]\n\
+Usage: amr [affect-rate] [epsilon] [test-file | --stdin]\n\
 \n\
 affect-rate: float value controlling the effect of neighboring boxes\n\
 epislon    : float value determining the cutoff for convergence\n\
-test-file  : test file with input to AMR problem\n";
+test-file  : test file with input to AMR problem, memory-mapped\n\
+--stdin    : read input from stdin of the master process instead\n";
 
 int main(int argc, char** argv) {
     MPI_Init(&argc, &argv);
@@ -47,12 +55,12 @@ int main(int argc, char** argv) {
         }
         float affect_rate = strtof(argv[1], NULL);
         float epsilon     = strtof(argv[2], NULL);
-        char* test_file   = argv[3];
+        char* test_file   = (strcmp(argv[3], "--stdin") != 0) ? argv[3] : NULL;
 
         /**
-         * Parse input data from standard input
+         * Parse input data from test file (or standard input)
          */
-        AMRInput* input = parseInput(test_file);
+        AMRInput* input = parseInput(test_file, omp_get_max_threads());
 
         /**
          * Run and collect timing information
@@ -98,6 +106,34 @@ int main(int argc, char** argv) {
     return 0;
 }
 
+/**
+ * Sends {@code count} elements of {@code bytes} bytes each,
+ * in messages of at most {@code MAX_MESSAGE_ELEMENTS} elements
+ */
+static void sendArray(const void* data, Offset count, size_t bytes, MPI_Datatype type, int rank, int message_tag) {
+    const char* next = (const char*) data;
+    do {
+        int part = (count > MAX_MESSAGE_ELEMENTS) ? MAX_MESSAGE_ELEMENTS : (int) count;
+        MPI_Send(next, part, type, rank, message_tag, MPI_COMM_WORLD);
+        next  += part * bytes;
+        count -= part;
+    } while (count > 0);
+}
+
+/**
+ * Receives an array sent by {@code sendArray()} from the master process
+ */
+static void recvArray(void* data, Offset count, size_t bytes, MPI_Datatype type, int message_tag) {
+    char* next = (char*) data;
+    do {
+        MPI_Status status;
+        int part = (count > MAX_MESSAGE_ELEMENTS) ? MAX_MESSAGE_ELEMENTS : (int) count;
+        MPI_Recv(next, part, type, 0, message_tag, MPI_COMM_WORLD, &status);
+        next  += part * bytes;
+        count -= part;
+    } while (count > 0);
+}
+
 /**
  * {@inheritDoc}
  */
@@ -126,20 +162,26 @@ AMROutput run_master(AMRInput* input, float affect_rate, float epsilon) {
 
         MPI_Send(&input->perimeters[0], input->N, COORD_MPI_TYPE, rank, perimeter_tag, MPI_COMM_WORLD);
         MPI_Send(&input->num_nhbrs[0], input->N, COUNT_MPI_TYPE, rank, num_nhbrs_tag, MPI_COMM_WORLD);
-        MPI_Send(&input->offsets[0], input->N, COUNT_MPI_TYPE, rank, offsets_tag, MPI_COMM_WORLD);
+        MPI_Send(&input->offsets[0], input->N, OFFSET_MPI_TYPE, rank, offsets_tag, MPI_COMM_WORLD);
         MPI_Send(&input->self_overlaps[0], input->N, COORD_MPI_TYPE, rank, self_overlaps_tag, MPI_COMM_WORLD);
 
-        MPI_Send(&input->total_nhbrs, 1, COUNT_MPI_TYPE, rank, total_nhbrs_tag, MPI_COMM_WORLD);
-        MPI_Send(&input->nhbr_ids[0], input->total_nhbrs, COUNT_MPI_TYPE, rank, nhbr_id_tag, MPI_COMM_WORLD);
-        MPI_Send(&input->overlaps[0], input->total_nhbrs, COORD_MPI_TYPE, rank, overlap_tag, MPI_COMM_WORLD);
+        MPI_Send(&input->total_nhbrs, 1, OFFSET_MPI_TYPE, rank, total_nhbrs_tag, MPI_COMM_WORLD);
+        sendArray(&input->nhbr_ids[0], input->total_nhbrs, sizeof(Count), COUNT_MPI_TYPE, rank, nhbr_id_tag);
+        sendArray(&input->overlaps[0], input->total_nhbrs, sizeof(Coord), COORD_MPI_TYPE, rank, overlap_tag);
     }
 
-    unsigned long iter;
-    for (iter = 0; (max_min.max - max_min.min) / max_min.max > epsilon; ++iter, max_min = getMaxMin(input)) {
+    /**
+     * Convergence is only checked when due (see {@code ConvergenceCheck}),
+     * which may roll the DSVs back to be sent again
+     */
+    ConvergenceCheck check;
+    initConvergenceCheck(&check, input, affect_rate, max_min);
+    unsigned long iter    = 0;
+    int           running = (max_min.max - max_min.min) / max_min.max > epsilon;
+    while (running) {
         /**
          * Send vals to processes
          */
-        int running = 1;
         for (int rank = 1; rank < size; ++rank) {
             MPI_Send(&running, 1, MPI_INT, rank, run_tag, MPI_COMM_WORLD);
             MPI_Send(&input->vals[0], input->N, DSV_MPI_TYPE, rank, dsv_tag, MPI_COMM_WORLD);
@@ -154,21 +196,30 @@ AMROutput run_master(AMRInput* input, float affect_rate, float epsilon) {
             Count end   = ends  [rank - 1];
             MPI_Recv(&input->vals[start], end - start, DSV_MPI_TYPE, rank, dsv_tag, MPI_COMM_WORLD, &status);
         }
+
+        ++iter;
+        if (checkDue(&check, iter)) {
+            max_min = getMaxMin(input);
+            running = finishCheck(&check, input->N, input->vals, max_min, epsilon, &iter);
+        }
     }
-    int running = 0;
     for (int rank = 1; rank < size; ++rank) {
         MPI_Send(&running, 1, MPI_INT, rank, run_tag, MPI_COMM_WORLD);
     }
+    destroyConvergenceCheck(&check);
 
     free(starts);
     free(ends);
 
-    AMROutput result;
+    AMROutput result = { 0 };
     result.affect_rate = affect_rate;
     result.epsilon     = epsilon;
     result.iterations  = iter;
     result.max         = max_min.max;
     result.min         = max_min.min;
+    result.parse_bytes   = input->parse_bytes;
+    result.parse_seconds   = input->parse_seconds;
+    result.overlap_seconds = input->overlap_seconds;
     return result;
 }
 
@@ -192,19 +243,33 @@ void run_computation() {
 
     Coord* perimeters    = malloc(N * sizeof(*perimeters));
     Count* num_nhbrs     = malloc(N * sizeof(*num_nhbrs));
-    Count* offsets       = malloc(N * sizeof(*offsets));
+    Offset* offsets      = malloc(N * sizeof(*offsets));
     Count* self_overlaps = malloc(N * sizeof(*self_overlaps));
     MPI_Recv(&perimeters[0], N, COORD_MPI_TYPE, 0, perimeter_tag, MPI_COMM_WORLD, &status);
     MPI_Recv(&num_nhbrs[0], N, COUNT_MPI_TYPE, 0, num_nhbrs_tag, MPI_COMM_WORLD, &status);
-    MPI_Recv(&offsets[0], N, COUNT_MPI_TYPE, 0, offsets_tag, MPI_COMM_WORLD, &status);
+    MPI_Recv(&offsets[0], N, OFFSET_MPI_TYPE, 0, offsets_tag, MPI_COMM_WORLD, &status);
     MPI_Recv(&self_overlaps[0], N, COORD_MPI_TYPE, 0, self_overlaps_tag, MPI_COMM_WORLD, &status);
 
-    Count total_nhbrs;
-    MPI_Recv(&total_nhbrs, 1, COUNT_MPI_TYPE, 0, total_nhbrs_tag, MPI_COMM_WORLD, &status);
+    Offset total_nhbrs;
+    MPI_Recv(&total_nhbrs, 1, OFFSET_MPI_TYPE, 0, total_nhbrs_tag, MPI_COMM_WORLD, &status);
     Count* nhbr_ids = malloc(total_nhbrs * sizeof(*nhbr_ids));
     Coord* overlaps = malloc(total_nhbrs * sizeof(*overlaps));
-    MPI_Recv(&nhbr_ids[0], total_nhbrs, COUNT_MPI_TYPE, 0, nhbr_id_tag, MPI_COMM_WORLD, &status);
-    MPI_Recv(&overlaps[0], total_nhbrs, COORD_MPI_TYPE, 0, overlap_tag, MPI_COMM_WORLD, &status);
+    recvArray(&nhbr_ids[0], total_nhbrs, sizeof(Count), COUNT_MPI_TYPE, nhbr_id_tag);
+    recvArray(&overlaps[0], total_nhbrs, sizeof(Coord), COORD_MPI_TYPE, overlap_tag);
+
+    /**
+     * Fold the coefficients that stay constant for
+     * the run into weights (for this rank's boxes)
+     */
+    AMRInput grid = { 0 };
+    grid.perimeters    = perimeters;
+    grid.num_nhbrs     = num_nhbrs;
+    grid.offsets       = offsets;
+    grid.self_overlaps = self_overlaps;
+    grid.overlaps      = overlaps;
+    Weight* diag_weights = malloc(N * sizeof(*diag_weights));
+    Weight* nhbr_weights = malloc(total_nhbrs * sizeof(*nhbr_weights));
+    computeWeightRange(&grid, affect_rate, start, end, diag_weights, nhbr_weights);
 
     int running;
     MPI_Recv(&running, 1, MPI_INT, 0, run_tag, MPI_COMM_WORLD, &status);
@@ -224,13 +289,10 @@ void run_computation() {
                 /**
                  * Compute updated DSV
                  */
-                updated_vals[i] = self_overlaps[i] * vals[i];
-                for (int nhbr = 0; nhbr < num_nhbrs[i]; ++nhbr) {
-                    updated_vals[i] += overlaps[offsets[i] + nhbr] * vals[nhbr_ids[offsets[i] + nhbr]];
+                updated_vals[i] = diag_weights[i] * vals[i];
+                for (Count nhbr = 0; nhbr < num_nhbrs[i]; ++nhbr) {
+                    updated_vals[i] += nhbr_weights[offsets[i] + nhbr] * vals[nhbr_ids[offsets[i] + nhbr]];
                 }
-                updated_vals[i] /= perimeters[i];
-                updated_vals[i] = vals[i] * (1 - affect_rate)
-                    + updated_vals[i] * affect_rate;
             }
         }
 
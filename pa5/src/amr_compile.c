@@ -0,0 +1,41 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "amrb.h"
+#include "common.h"
+#include "ingest.h"
+
+const char* usage = "\
+Usage: amr-compile [test-file | --stdin] [output-file]\n\
+\n\
+test-file  : test file with input to AMR problem (text or compiled)\n\
+--stdin    : read input from stdin instead\n\
+output-file: path of the compiled binary grid (.amrb) to write\n";
+
+int main(int argc, char** argv) {
+    /**
+     * Parse command-line arguments
+     */
+    if (argc != 3) {
+        printf("%s", usage);
+        exit(1);
+    }
+    const char* test_file   = (strcmp(argv[1], "--stdin") != 0) ? argv[1] : NULL;
+    const char* output_file = argv[2];
+
+    /**
+     * Parse, preprocess and write out the grid
+     */
+    AMRInput* input = parseInput(test_file, parseThreads());
+    writeBinaryInput(input, output_file);
+
+    printf("Compiled "COUNT_SPEC" boxes to %s (parsed in %lf seconds)\n",
+           input->N, output_file, input->parse_seconds);
+
+    /**
+     * Clean up
+     */
+    destroyInput(input);
+    return 0;
+}
@@ -0,0 +1,98 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "convergence.h"
+
+/**
+ * {@inheritDoc}
+ */
+int deferredEnabled() {
+    const char* enabled = getenv(DEFERRED_ENV);
+    return (enabled != NULL) && (*enabled != '\0') && (strcmp(enabled, "0") != 0);
+}
+
+/**
+ * {@inheritDoc}
+ */
+void initConvergenceCheck(ConvergenceCheck* check, const AMRInput* input, float affect_rate,
+                          AMRMaxMin max_min) {
+    check->deferred   = deferredEnabled() && (affect_rate >= 0) && (affect_rate <= 1);
+    check->replaying  = 0;
+    check->next_check = 1;
+    check->last_check = 0;
+    check->last_gap   = (max_min.max - max_min.min) / max_min.max;
+    check->snapshot   = NULL;
+    check->checks     = 0;
+    check->rollbacks  = 0;
+    if (check->deferred) {
+        check->snapshot = malloc(input->N * sizeof(*check->snapshot));
+    }
+}
+
+/**
+ * Iterations until the next check: half of those left if the gap keeps
+ * shrinking by {@code ratio} every {@code steps} iterations
+ */
+static unsigned long nextInterval(double gap, double ratio, unsigned long steps, float epsilon) {
+    if (!(ratio < 1)) {
+        return DEFERRED_MAX_INTERVAL;
+    }
+    unsigned long left = 0;
+    while ((gap > epsilon) && (left < 2 * DEFERRED_MAX_INTERVAL)) {
+        gap  *= ratio;
+        left += steps;
+    }
+    unsigned long interval = left / 2;
+    if (interval < 1) {
+        return 1;
+    }
+    return (interval > DEFERRED_MAX_INTERVAL) ? DEFERRED_MAX_INTERVAL : interval;
+}
+
+/**
+ * {@inheritDoc}
+ */
+int finishCheck(ConvergenceCheck* check, Count N, DSV* vals, AMRMaxMin max_min,
+                float epsilon, unsigned long* iter) {
+    double gap = (max_min.max - max_min.min) / max_min.max;
+    ++check->checks;
+    if (!(gap > epsilon)) {
+        if (*iter - check->last_check <= 1) {
+            return 0;
+        }
+
+        /**
+         * Converged somewhere since the last check: go back and find where
+         */
+        memcpy(vals, check->snapshot, N * sizeof(*vals));
+        *iter             = check->last_check;
+        check->next_check = check->last_check + 1;
+        check->replaying  = 1;
+        ++check->rollbacks;
+        return 1;
+    }
+
+    unsigned long interval = 1;
+    if (check->deferred && !check->replaying) {
+        interval = nextInterval(gap, gap / check->last_gap, *iter - check->last_check, epsilon);
+    }
+
+    /**
+     * The DSVs only need keeping if the next check may have to roll back
+     */
+    if (interval > 1) {
+        memcpy(check->snapshot, vals, N * sizeof(*vals));
+    }
+    check->last_check = *iter;
+    check->last_gap   = gap;
+    check->next_check = *iter + interval;
+    return 1;
+}
+
+/**
+ * {@inheritDoc}
+ */
+void destroyConvergenceCheck(ConvergenceCheck* check) {
+    free(check->snapshot);
+    check->snapshot = NULL;
+}
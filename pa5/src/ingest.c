@@ -0,0 +1,453 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "adjacency.h"
+#include "ingest.h"
+
+extern const char* invalid_format;
+
+/**
+ * Per-thread state while reading a chunk of box records
+ *
+ * {@code cursor}   - private cursor, starts at the chunk's first record
+ * {@code first}    - id of the first box in the chunk
+ * {@code last}     - one past the id of the last box in the chunk
+ * {@code next}     - where the chunk's records were expected to end
+ * {@code nhbr_ids} - neighbor ids read by this thread, with room for
+ *                    {@code capacity} ids
+ * {@code grow}     - arena {@code nhbr_ids} comes from, grown in once full
+ * {@code base}     - offset of the chunk's neighbor ids in the final array
+ * {@code valid}    - cleared if the chunk could not be read
+ */
+typedef struct ChunkData {
+    GridRecords* records;
+    InputBuffer  cursor;
+    Count        first;
+    Count        last;
+    const char*  next;
+
+    Count* nhbr_ids;
+    Offset num_ids;
+    Offset capacity;
+    Arena* grow;
+    Offset base;
+    int    valid;
+} ChunkData;
+
+/**
+ * {@inheritDoc}
+ */
+Count parseThreads() {
+    const char* value = getenv(PARSE_THREADS_ENV);
+    if (value == NULL) {
+        return 1;
+    }
+    long num_threads = strtol(value, NULL, 10);
+    return (num_threads < 1) ? 1 : num_threads;
+}
+
+/**
+ * Starts the room for neighbor ids at an estimate of
+ * {@code CHUNK_IDS_PER_BOX} ids for each of the chunk's boxes
+ */
+static void reserveChunk(ChunkData* chunk, Arena* grow) {
+    chunk->grow     = grow;
+    chunk->capacity = (Offset) CHUNK_IDS_PER_BOX * (chunk->last - chunk->first) + 1;
+    chunk->nhbr_ids = arenaAlloc(grow, chunk->capacity * sizeof(*chunk->nhbr_ids));
+}
+
+/**
+ * Doubles the room for neighbor ids (or more, to fit {@code needed} more ids)
+ */
+static void growChunk(ChunkData* chunk, Count needed) {
+    Offset capacity = 2 * chunk->capacity;
+    if (capacity < chunk->num_ids + needed) {
+        capacity = chunk->num_ids + needed;
+    }
+    chunk->nhbr_ids = arenaGrow(chunk->grow, chunk->nhbr_ids,
+                                chunk->num_ids * sizeof(*chunk->nhbr_ids),
+                                capacity * sizeof(*chunk->nhbr_ids));
+    chunk->capacity = capacity;
+}
+
+/**
+ * Reads the records of boxes [first, last) at the chunk's cursor.
+ * Neighbor counts are stored in {@code offsets[i+1]} for now
+ * and turned into offsets by {@code placeChunk}.
+ *
+ * @return 1 on success, 0 on malformed input
+ */
+static int readChunk(ChunkData* chunk) {
+    GridRecords* records = chunk->records;
+    InputBuffer* cursor  = &chunk->cursor;
+
+    for (Count i = chunk->first; i < chunk->last; ++i) {
+        /**
+         * Verify that ids are sequential
+         */
+        Count id;
+        if (!readCount(cursor, &id) || (id != i)) {
+            return 0;
+        }
+
+        /**
+         * Size and position information
+         */
+        Coord y, x, height, width;
+        if (!readCoord(cursor, &y) || !readCoord(cursor, &x)
+            || !readCoord(cursor, &height) || !readCoord(cursor, &width)) {
+            return 0;
+        }
+        BoxBounds* bounds = &records->bounds[i];
+        bounds->x_min = x;
+        bounds->x_max = x + width;
+        bounds->y_min = y;
+        bounds->y_max = y + height;
+
+        /**
+         * Topology information
+         */
+        Count total = 0;
+        for (DIRECTION dir = TOP; dir <= RIGHT; ++dir) {
+            Count num_nhbrs;
+            if (!readCount(cursor, &num_nhbrs)) {
+                return 0;
+            }
+            records->dir_nhbrs[NUM_DIR * i + dir] = num_nhbrs;
+            if (num_nhbrs > chunk->capacity - chunk->num_ids) {
+                growChunk(chunk, num_nhbrs);
+            }
+            for (Count nhbr = 0; nhbr < num_nhbrs; ++nhbr) {
+                Count nhbr_id;
+                if (!readCount(cursor, &nhbr_id) || (nhbr_id >= records->N)) {
+                    return 0;
+                }
+                chunk->nhbr_ids[chunk->num_ids++] = nhbr_id;
+            }
+            total += num_nhbrs;
+        }
+        records->offsets[i + 1] = total;
+
+        /**
+         * DSV information
+         */
+        if (!readDSV(cursor, &records->vals[i])) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * Turns the chunk's neighbor counts into offsets starting
+ * at {@code chunk->base} and moves its neighbor ids into place
+ */
+static void placeChunk(ChunkData* chunk) {
+    GridRecords* records = chunk->records;
+    Offset offset = chunk->base;
+    for (Count i = chunk->first; i < chunk->last; ++i) {
+        offset += records->offsets[i + 1];
+        records->offsets[i + 1] = offset;
+    }
+    memcpy(&records->nhbr_ids[chunk->base], chunk->nhbr_ids,
+           chunk->num_ids * sizeof(*chunk->nhbr_ids));
+}
+
+static void* readChunkWorker(void* data) {
+    ChunkData* chunk = (ChunkData*) data;
+    chunk->valid = readChunk(chunk);
+
+    /**
+     * The next chunk must start exactly where this one stops,
+     * otherwise its starting point was not a real record boundary
+     */
+    if (chunk->valid && (chunk->next != NULL)) {
+        InputBuffer* cursor = &chunk->cursor;
+        while ((cursor->pos < cursor->end)
+               && ((*cursor->pos == ' ') || (*cursor->pos == '\n')
+                   || (*cursor->pos == '\t') || (*cursor->pos == '\r'))) {
+            ++cursor->pos;
+        }
+        chunk->valid = (cursor->pos == chunk->next);
+    }
+    return NULL;
+}
+
+static void* placeChunkWorker(void* data) {
+    placeChunk((ChunkData*) data);
+    return NULL;
+}
+
+/**
+ * Counts the whitespace-separated tokens on the line starting at
+ * {@code pos} and stores the start of the following line in {@code next}
+ */
+static int lineTokens(const char* pos, const char* end, const char** next) {
+    int tokens   = 0;
+    int in_token = 0;
+    while ((pos < end) && (*pos != '\n')) {
+        int space = (*pos == ' ') || (*pos == '\t') || (*pos == '\r');
+        if (!space && !in_token) {
+            ++tokens;
+        }
+        in_token = !space;
+        ++pos;
+    }
+    *next = (pos < end) ? pos + 1 : end;
+    return tokens;
+}
+
+/**
+ * Checks whether a complete box record starts at {@code pos},
+ * followed by the next record's id (unless it is the last box)
+ */
+static int probeRecord(const InputBuffer* buffer, const char* pos, Count N, Count* id) {
+    InputBuffer cursor = *buffer;
+    cursor.pos = pos;
+
+    Coord coord;
+    Count count, nhbr_id, next_id;
+    DSV   val;
+    if (!readCount(&cursor, id) || (*id >= N)) {
+        return 0;
+    }
+    for (int c = 0; c < 4; ++c) {
+        if (!readCoord(&cursor, &coord)) {
+            return 0;
+        }
+    }
+    for (DIRECTION dir = TOP; dir <= RIGHT; ++dir) {
+        if (!readCount(&cursor, &count) || (count > N)) {
+            return 0;
+        }
+        for (Count nhbr = 0; nhbr < count; ++nhbr) {
+            if (!readCount(&cursor, &nhbr_id) || (nhbr_id >= N)) {
+                return 0;
+            }
+        }
+    }
+    if (!readDSV(&cursor, &val)) {
+        return 0;
+    }
+    return (*id == N - 1) || (readCount(&cursor, &next_id) && (next_id == *id + 1));
+}
+
+/**
+ * Finds the first box record starting on a line at or after {@code pos}.
+ * A record starts with a line holding only the box id, followed by
+ * a line holding the four geometry values.
+ *
+ * @return start of the record, or {@code NULL} if there is none
+ */
+static const char* findRecord(const InputBuffer* buffer, const char* pos, Count N, Count* id) {
+    const char* end = buffer->end;
+    while ((pos > buffer->data) && (pos < end) && (pos[-1] != '\n')) {
+        ++pos;
+    }
+    while (pos < end) {
+        const char* next;
+        const char* after;
+        if ((lineTokens(pos, end, &next) == 1)
+            && (lineTokens(next, end, &after) == 4)
+            && probeRecord(buffer, pos, N, id)
+        ) {
+            return pos;
+        }
+        pos = next;
+    }
+    return NULL;
+}
+
+/**
+ * Reads the records of a geometry-only grid
+ *
+ * @return 1 on success, 0 on malformed input
+ */
+static int readGeometry(GridRecords* records, InputBuffer* buffer) {
+    for (Count i = 0; i < records->N; ++i) {
+        Count id;
+        Coord y, x, height, width;
+        if (!readCount(buffer, &id) || (id != i)
+            || !readCoord(buffer, &y) || !readCoord(buffer, &x)
+            || !readCoord(buffer, &height) || !readCoord(buffer, &width)
+            || !readDSV(buffer, &records->vals[i])) {
+            return 0;
+        }
+        BoxBounds* bounds = &records->bounds[i];
+        bounds->x_min = x;
+        bounds->x_max = x + width;
+        bounds->y_min = y;
+        bounds->y_max = y + height;
+    }
+    return 1;
+}
+
+/**
+ * Reads the records in parallel.
+ *
+ * @return 1 on success, 0 if the serial reader should be used instead
+ */
+static int readChunksParallel(GridRecords* records, InputBuffer* buffer, Count num_threads,
+                              Arena* arena, Arena* scratch) {
+    ChunkData* chunks  = arenaAlloc(scratch, num_threads * sizeof(*chunks));
+    pthread_t* threads = arenaAlloc(scratch, num_threads * sizeof(*threads));
+    memset(chunks, 0, num_threads * sizeof(*chunks));
+
+    /**
+     * Split the input into roughly equal chunks,
+     * each starting at a box record
+     */
+    size_t length     = buffer->end - buffer->pos;
+    Count  num_chunks = 0;
+    for (Count t = 0; t < num_threads; ++t) {
+        const char* start;
+        Count       id;
+        if (t == 0) {
+            start = buffer->pos;
+            id    = 0;
+        } else {
+            start = findRecord(buffer, buffer->pos + t * (length / num_threads), records->N, &id);
+            if ((start == NULL) || (id <= chunks[num_chunks - 1].first)) {
+                continue;
+            }
+            chunks[num_chunks - 1].last = id;
+            chunks[num_chunks - 1].next = start;
+        }
+        chunks[num_chunks].records    = records;
+        chunks[num_chunks].cursor     = *buffer;
+        chunks[num_chunks].cursor.pos = start;
+        chunks[num_chunks].first      = id;
+        chunks[num_chunks].last       = records->N;
+        chunks[num_chunks].next       = NULL;
+        ++num_chunks;
+    }
+
+    /**
+     * Each chunk grows its ids in an arena of its own
+     */
+    for (Count t = 0; t < num_chunks; ++t) {
+        reserveChunk(&chunks[t], createArena(ARENA_BLOCK_SIZE));
+    }
+
+    /**
+     * Read chunks concurrently into per-thread buffers,
+     * leaving it to the serial reader if a thread can not be started
+     */
+    Count started = 0;
+    while ((started < num_chunks)
+           && (pthread_create(&threads[started], NULL, &readChunkWorker, (void*) &chunks[started]) == 0)) {
+        ++started;
+    }
+    int valid = (started == num_chunks);
+    for (Count t = 0; t < started; ++t) {
+        pthread_join(threads[t], NULL);
+        valid = valid && chunks[t].valid;
+    }
+
+    if (valid) {
+        /**
+         * Prefix sum over chunk totals gives each chunk's base,
+         * then chunks finish their offsets and copy their ids concurrently
+         */
+        Offset total_nhbrs = 0;
+        for (Count t = 0; t < num_chunks; ++t) {
+            chunks[t].base = total_nhbrs;
+            total_nhbrs   += chunks[t].num_ids;
+        }
+        records->nhbr_ids = arenaAlloc(arena, total_nhbrs * sizeof(*records->nhbr_ids));
+        started = 0;
+        while ((started < num_chunks)
+               && (pthread_create(&threads[started], NULL, &placeChunkWorker, (void*) &chunks[started]) == 0)) {
+            ++started;
+        }
+        for (Count t = started; t < num_chunks; ++t) {
+            placeChunk(&chunks[t]);
+        }
+        for (Count t = 0; t < started; ++t) {
+            pthread_join(threads[t], NULL);
+        }
+    }
+    for (Count t = 0; t < num_chunks; ++t) {
+        destroyArena(chunks[t].grow);
+    }
+    return valid;
+}
+
+/**
+ * {@inheritDoc}
+ */
+GridRecords* readGridRecords(InputBuffer* buffer, Count num_threads, Arena* arena, Arena* scratch) {
+    GridRecords* records = arenaAlloc(scratch, sizeof(*records));
+
+    /**
+     * Read in general parameters
+     */
+    int geometry = readKeyword(buffer, GEOMETRY_KEYWORD);
+    if (!readCount(buffer, &records->N)
+        || !readCoord(buffer, &records->rows)
+        || !readCoord(buffer, &records->cols)) {
+        fprintf(stderr, "%s", invalid_format);
+        exit(1);
+    }
+
+    /**
+     * Allocate arrays for per-box values
+     */
+    Count N = records->N;
+    records->bounds    = arenaAlloc(arena, N * sizeof(*records->bounds));
+    records->dir_nhbrs = arenaAlloc(scratch, NUM_DIR * N * sizeof(*records->dir_nhbrs));
+    records->vals      = arenaAlloc(arena, N * sizeof(*records->vals));
+    records->offsets   = arenaAlloc(arena, (N + 1) * sizeof(*records->offsets));
+    records->nhbr_ids  = NULL;
+    records->offsets[0] = 0;
+
+    if (geometry) {
+        if (!readGeometry(records, buffer)) {
+            fprintf(stderr, "%s", invalid_format);
+            exit(1);
+        }
+        buildAdjacency(records, arena, scratch);
+        return records;
+    }
+
+    size_t length = buffer->end - buffer->pos;
+    if (num_threads > length / MIN_CHUNK_BYTES) {
+        num_threads = length / MIN_CHUNK_BYTES;
+    }
+    if (buffer->stream != NULL) {
+        num_threads = 1;
+    }
+    if ((num_threads > 1) && readChunksParallel(records, buffer, num_threads, arena, scratch)) {
+        return records;
+    }
+
+    /**
+     * Serial reader: a single chunk reading straight into the final
+     * neighbor array, which grows in place as needed
+     * and is cut down to size afterwards
+     */
+    ChunkData chunk;
+    memset(&chunk, 0, sizeof(chunk));
+    chunk.records = records;
+    chunk.cursor  = *buffer;
+    chunk.first   = 0;
+    chunk.last    = N;
+    reserveChunk(&chunk, arena);
+    if (!readChunk(&chunk)) {
+        fprintf(stderr, "%s", invalid_format);
+        exit(1);
+    }
+    arenaTrim(arena, chunk.nhbr_ids, chunk.num_ids * sizeof(*chunk.nhbr_ids));
+
+    Offset offset = 0;
+    for (Count i = 0; i < N; ++i) {
+        offset += records->offsets[i + 1];
+        records->offsets[i + 1] = offset;
+    }
+    records->nhbr_ids = chunk.nhbr_ids;
+    *buffer           = chunk.cursor;
+
+    return records;
+}
@@ -0,0 +1,88 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "overlap.h"
+
+/**
+ * Body of an overlap thread
+ */
+static void* overlapRange(void* data) {
+    OverlapTask*       task    = (OverlapTask*) data;
+    const GridRecords* records = task->records;
+    const BoxBounds*   bounds  = records->bounds;
+
+    for (Count i = task->start; i < task->end; ++i) {
+        const BoxBounds* box_bounds = &bounds[i];
+        const Count*     dir_nhbrs  = &records->dir_nhbrs[NUM_DIR * i];
+        Offset           offset     = records->offsets[i];
+
+        Coord self_overlap = 2 * ((box_bounds->x_max - box_bounds->x_min)
+                                + (box_bounds->y_max - box_bounds->y_min));
+
+        /**
+         * TOP and BOTTOM neighbors share part of an x-extent,
+         * LEFT and RIGHT neighbors part of a y-extent
+         */
+        for (DIRECTION dir = TOP; dir <= RIGHT; ++dir) {
+            for (Count nhbr = 0; nhbr < dir_nhbrs[dir]; ++nhbr, ++offset) {
+                const BoxBounds* nhbr_bounds = &bounds[records->nhbr_ids[offset]];
+                Coord overlap = (dir <= BOTTOM)
+                    ? min(box_bounds->x_max, nhbr_bounds->x_max) - max(box_bounds->x_min, nhbr_bounds->x_min)
+                    : min(box_bounds->y_max, nhbr_bounds->y_max) - max(box_bounds->y_min, nhbr_bounds->y_min);
+                task->overlaps[offset] = overlap;
+                self_overlap          -= overlap;
+            }
+        }
+        task->self_overlaps[i] = self_overlap;
+    }
+    return NULL;
+}
+
+/**
+ * {@inheritDoc}
+ */
+void computeOverlaps(const GridRecords* records, Count num_threads, Coord* overlaps, Coord* self_overlaps) {
+    Count N = records->N;
+    if (num_threads > N / MIN_OVERLAP_BOXES) {
+        num_threads = N / MIN_OVERLAP_BOXES;
+    }
+    if (num_threads < 1) {
+        num_threads = 1;
+    }
+
+    /**
+     * Split so every thread gets about the same number of
+     * neighbors plus boxes (the offsets give both as a prefix sum)
+     */
+    OverlapTask* tasks   = malloc(num_threads * sizeof(*tasks));
+    pthread_t*   threads = malloc(num_threads * sizeof(*threads));
+    double       work    = (double) records->offsets[N] + N;
+    Count        start   = 0;
+    for (Count tid = 0; tid < num_threads; ++tid) {
+        double target = work * (tid + 1) / num_threads;
+        Count  end    = start;
+        while ((end < N) && ((double) records->offsets[end] + end < target)) {
+            ++end;
+        }
+        if (tid == num_threads - 1) {
+            end = N;
+        }
+        tasks[tid] = (OverlapTask) { records, start, end, overlaps, self_overlaps };
+        start      = end;
+    }
+
+    for (Count tid = 1; tid < num_threads; ++tid) {
+        if (pthread_create(&threads[tid], NULL, &overlapRange, (void*) &tasks[tid]) != 0) {
+            perror("pthread_create");
+            exit(1);
+        }
+    }
+    overlapRange((void*) &tasks[0]);
+    for (Count tid = 1; tid < num_threads; ++tid) {
+        pthread_join(threads[tid], NULL);
+    }
+
+    free(tasks);
+    free(threads);
+}
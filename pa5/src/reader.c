@@ -0,0 +1,312 @@
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "reader.h"
+#include "stream.h"
+
+/**
+ * Exact powers of ten, used by the fast path of {@code readDSV}
+ */
+static const double powers_of_ten[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+    1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+    1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+#define MAX_EXACT_POWER 22
+#define MAX_EXACT_MANTISSA (1ULL << 53)
+
+/**
+ * Moves a streamed buffer on to its next window
+ *
+ * @return 1 if there is more input, 0 at the end of the input
+ */
+static int refillInputBuffer(InputBuffer* buffer) {
+    if ((buffer->stream == NULL)
+        || !nextStreamWindow(buffer->stream, &buffer->data, &buffer->end)) {
+        return 0;
+    }
+    buffer->pos  = buffer->data;
+    buffer->size = buffer->stream->bytes;
+    return 1;
+}
+
+/**
+ * Reads all of {@code fd} into the heap in blocks
+ * of {@code READ_BLOCK_SIZE}
+ */
+static void readBlocks(InputBuffer* buffer, int fd) {
+    size_t capacity = READ_BLOCK_SIZE;
+    size_t size     = 0;
+    char*  data     = malloc(capacity);
+    for (;;) {
+        if (capacity - size < READ_BLOCK_SIZE) {
+            capacity *= 2;
+            data      = realloc(data, capacity);
+        }
+        ssize_t bytes = read(fd, data + size, READ_BLOCK_SIZE);
+        if (bytes < 0) {
+            perror("read");
+            exit(1);
+        }
+        if (bytes == 0) {
+            break;
+        }
+        size += bytes;
+    }
+    buffer->data   = data;
+    buffer->size   = size;
+    buffer->mapped = 0;
+}
+
+/**
+ * {@inheritDoc}
+ */
+InputBuffer* openInputBuffer(const char* file_name) {
+    int fd = STDIN_FILENO;
+    if (file_name != NULL) {
+        fd = open(file_name, O_RDONLY);
+        if (fd < 0) {
+            perror(file_name);
+            exit(1);
+        }
+    }
+
+    InputBuffer* buffer = malloc(sizeof(*buffer));
+    buffer->stream = NULL;
+
+    struct stat info;
+    Compression format = detectCompression(fd);
+    if (format != COMPRESSION_NONE) {
+        buffer->stream = openInputStream(fd, format);
+        buffer->data   = NULL;
+        buffer->size   = 0;
+        buffer->mapped = 0;
+    } else if ((fstat(fd, &info) == 0) && S_ISREG(info.st_mode) && (info.st_size > 0)) {
+        void* data = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            readBlocks(buffer, fd);
+        } else {
+            madvise(data, info.st_size, MADV_SEQUENTIAL);
+            buffer->data   = data;
+            buffer->size   = info.st_size;
+            buffer->mapped = 1;
+        }
+    } else {
+        readBlocks(buffer, fd);
+    }
+    buffer->pos = buffer->data;
+    buffer->end = buffer->data + buffer->size;
+
+    /**
+     * Streams start out on their first window
+     */
+    refillInputBuffer(buffer);
+
+    if (file_name != NULL) {
+        close(fd);
+    }
+    return buffer;
+}
+
+/**
+ * {@inheritDoc}
+ */
+void closeInputBuffer(InputBuffer* buffer) {
+    if (buffer->stream != NULL) {
+        closeInputStream(buffer->stream);
+    } else if (buffer->mapped) {
+        munmap((void*) buffer->data, buffer->size);
+    } else {
+        free((void*) buffer->data);
+    }
+    free(buffer);
+}
+
+/**
+ * Advances the cursor past any whitespace.
+ * Streamed buffers move on to the next window when the current one
+ * runs out, windows end at whitespace so a token never straddles two.
+ */
+static inline void skipWhitespace(InputBuffer* buffer) {
+    for (;;) {
+        const char* pos = buffer->pos;
+        const char* end = buffer->end;
+        while ((pos < end) && ((*pos == ' ') || (*pos == '\n') || (*pos == '\t') || (*pos == '\r'))) {
+            ++pos;
+        }
+        buffer->pos = pos;
+        if ((pos < end) || !refillInputBuffer(buffer)) {
+            return;
+        }
+    }
+}
+
+/**
+ * Reads an unsigned decimal integer at the cursor,
+ * saturating at {@code ULLONG_MAX} (so too large for any field)
+ */
+static inline int readUnsigned(InputBuffer* buffer, unsigned long long* value) {
+    skipWhitespace(buffer);
+    const char* pos = buffer->pos;
+    const char* end = buffer->end;
+    if ((pos == end) || ((unsigned) (*pos - '0') > 9)) {
+        return 0;
+    }
+
+    unsigned long long result = 0;
+    while ((pos < end) && ((unsigned) (*pos - '0') <= 9)) {
+        unsigned digit = *pos - '0';
+        result = (result > (ULLONG_MAX - digit) / 10) ? ULLONG_MAX : 10 * result + digit;
+        ++pos;
+    }
+    buffer->pos = pos;
+    *value      = result;
+    return 1;
+}
+
+/**
+ * {@inheritDoc}
+ */
+int readKeyword(InputBuffer* buffer, const char* keyword) {
+    skipWhitespace(buffer);
+    size_t      length = strlen(keyword);
+    const char* pos    = buffer->pos;
+    const char* end    = buffer->end;
+    if (((size_t) (end - pos) < length) || (memcmp(pos, keyword, length) != 0)) {
+        return 0;
+    }
+    pos += length;
+    if ((pos < end) && (*pos != ' ') && (*pos != '\n') && (*pos != '\t') && (*pos != '\r')) {
+        return 0;
+    }
+    buffer->pos = pos;
+    return 1;
+}
+
+/**
+ * {@inheritDoc}
+ */
+int readCount(InputBuffer* buffer, Count* value) {
+    unsigned long long result;
+    if (!readUnsigned(buffer, &result) || (result > (Count) -1)) {
+        return 0;
+    }
+    *value = result;
+    return 1;
+}
+
+/**
+ * {@inheritDoc}
+ */
+int readCoord(InputBuffer* buffer, Coord* value) {
+    unsigned long long result;
+    if (!readUnsigned(buffer, &result) || (result > (Coord) -1)) {
+        return 0;
+    }
+    *value = result;
+    return 1;
+}
+
+/**
+ * {@inheritDoc}
+ *
+ * Values with at most 53 bits of mantissa and a small decimal exponent
+ * are converted exactly with a single multiply or divide by a power of ten.
+ * Anything else is handed to {@code strtod}, which is rare for AMR input.
+ */
+int readDSV(InputBuffer* buffer, DSV* value) {
+    skipWhitespace(buffer);
+    const char* start = buffer->pos;
+    const char* pos   = start;
+    const char* end   = buffer->end;
+
+    int negative = 0;
+    if ((pos < end) && ((*pos == '-') || (*pos == '+'))) {
+        negative = (*pos == '-');
+        ++pos;
+    }
+
+    unsigned long long mantissa = 0;
+    int digits   = 0;
+    int exponent = 0;
+    int overflow = 0;
+    while ((pos < end) && ((unsigned) (*pos - '0') <= 9)) {
+        if (mantissa < MAX_EXACT_MANTISSA) {
+            mantissa = 10 * mantissa + (*pos - '0');
+        } else {
+            overflow = 1;
+        }
+        ++digits;
+        ++pos;
+    }
+    if ((pos < end) && (*pos == '.')) {
+        ++pos;
+        while ((pos < end) && ((unsigned) (*pos - '0') <= 9)) {
+            if (mantissa < MAX_EXACT_MANTISSA) {
+                mantissa = 10 * mantissa + (*pos - '0');
+                --exponent;
+            } else {
+                overflow = 1;
+            }
+            ++digits;
+            ++pos;
+        }
+    }
+    if (digits == 0) {
+        return 0;
+    }
+    if ((pos < end) && ((*pos == 'e') || (*pos == 'E'))) {
+        const char* exp_pos = pos + 1;
+        int exp_negative = 0;
+        if ((exp_pos < end) && ((*exp_pos == '-') || (*exp_pos == '+'))) {
+            exp_negative = (*exp_pos == '-');
+            ++exp_pos;
+        }
+        if ((exp_pos < end) && ((unsigned) (*exp_pos - '0') <= 9)) {
+            int exp_value = 0;
+            while ((exp_pos < end) && ((unsigned) (*exp_pos - '0') <= 9)) {
+                if (exp_value < 10000) {
+                    exp_value = 10 * exp_value + (*exp_pos - '0');
+                }
+                ++exp_pos;
+            }
+            exponent += exp_negative ? -exp_value : exp_value;
+            pos       = exp_pos;
+        }
+    }
+    buffer->pos = pos;
+
+    if (!overflow
+        && (mantissa <= MAX_EXACT_MANTISSA)
+        && (exponent >= -MAX_EXACT_POWER)
+        && (exponent <= MAX_EXACT_POWER)
+    ) {
+        double result = (double) mantissa;
+        if (exponent < 0) {
+            result /= powers_of_ten[-exponent];
+        } else {
+            result *= powers_of_ten[exponent];
+        }
+        *value = negative ? -result : result;
+        return 1;
+    }
+
+    /**
+     * Slow path, needs a NUL-terminated copy of the token
+     */
+    char token[128];
+    size_t length = pos - start;
+    if (length >= sizeof(token)) {
+        return 0;
+    }
+    memcpy(token, start, length);
+    token[length] = '\0';
+    *value = strtod(token, NULL);
+    return 1;
+}
@@ -0,0 +1,360 @@
+#include <spawn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <zlib.h>
+#ifdef USE_LIBZSTD
+#include <zstd.h>
+#endif
+
+#include "stream.h"
+
+extern const char* invalid_format;
+extern char**      environ;
+
+const char* invalid_compressed = "Error: could not decompress input\n";
+
+#ifdef USE_LIBZSTD
+/**
+ * Decoder state when decompressing .zst input in-process
+ */
+typedef struct ZstdState {
+    ZSTD_DStream*  dstream;
+    ZSTD_inBuffer  input;
+    char*          data;
+    size_t         capacity;
+    int            eof;
+} ZstdState;
+#endif
+
+/**
+ * {@inheritDoc}
+ */
+Compression detectCompression(int fd) {
+    struct stat   info;
+    unsigned char magic[4];
+    if ((fstat(fd, &info) != 0) || !S_ISREG(info.st_mode)
+        || (pread(fd, magic, sizeof(magic), 0) != sizeof(magic))) {
+        return COMPRESSION_NONE;
+    }
+    if ((magic[0] == 0x1f) && (magic[1] == 0x8b)) {
+        return COMPRESSION_GZIP;
+    }
+    if ((magic[0] == 0x28) && (magic[1] == 0xb5) && (magic[2] == 0x2f) && (magic[3] == 0xfd)) {
+        return COMPRESSION_ZSTD;
+    }
+    return COMPRESSION_NONE;
+}
+
+/**
+ * Decompresses up to {@code capacity} bytes of gzip input
+ *
+ * @return number of bytes, 0 at the end of the input, -1 on error
+ */
+static ssize_t readGzip(InputStream* stream, char* data, size_t capacity) {
+    size_t size = 0;
+    while (size < capacity) {
+        int bytes = gzread((gzFile) stream->gz, data + size, capacity - size);
+        if (bytes < 0) {
+            return -1;
+        }
+        if (bytes == 0) {
+            int error;
+            gzerror((gzFile) stream->gz, &error);
+            if ((error != Z_OK) && (error != Z_STREAM_END)) {
+                return -1;
+            }
+            break;
+        }
+        size += bytes;
+    }
+    return size;
+}
+
+#ifdef USE_LIBZSTD
+/**
+ * Decompresses up to {@code capacity} bytes of zstd input
+ *
+ * @return number of bytes, 0 at the end of the input, -1 on error
+ */
+static ssize_t readZstd(InputStream* stream, char* data, size_t capacity) {
+    ZstdState*     state  = (ZstdState*) stream->zstd;
+    ZSTD_outBuffer output = { data, capacity, 0 };
+    while (output.pos < output.size) {
+        if ((state->input.pos == state->input.size) && !state->eof) {
+            ssize_t bytes = read(stream->fd, state->data, state->capacity);
+            if (bytes < 0) {
+                return -1;
+            }
+            state->eof        = (bytes == 0);
+            state->input.src  = state->data;
+            state->input.size = bytes;
+            state->input.pos  = 0;
+        }
+        size_t before = output.pos;
+        if (ZSTD_isError(ZSTD_decompressStream(state->dstream, &output, &state->input))) {
+            return -1;
+        }
+        if (state->eof && (output.pos == before)) {
+            break;
+        }
+    }
+    return output.pos;
+}
+#else
+/**
+ * Reads up to {@code capacity} bytes decompressed by the zstd tool
+ *
+ * @return number of bytes, 0 at the end of the input, -1 on error
+ */
+static ssize_t readZstd(InputStream* stream, char* data, size_t capacity) {
+    size_t size = 0;
+    while (size < capacity) {
+        ssize_t bytes = read(stream->fd, data + size, capacity - size);
+        if (bytes < 0) {
+            return -1;
+        }
+        if (bytes == 0) {
+            break;
+        }
+        size += bytes;
+    }
+
+    /**
+     * The tool only reports errors through its exit status
+     */
+    if ((size == 0) && (stream->child > 0)) {
+        int status;
+        waitpid(stream->child, &status, 0);
+        stream->child = -1;
+        if (!WIFEXITED(status) || (WEXITSTATUS(status) != 0)) {
+            return -1;
+        }
+    }
+    return size;
+}
+#endif
+
+/**
+ * Body of the decompressing thread, fills free blocks
+ * in ring order until the end of the input
+ */
+static void* decompressBlocks(void* data) {
+    InputStream* stream = (InputStream*) data;
+    for (;;) {
+        pthread_mutex_lock(&stream->lock);
+        while ((stream->num_free == 0) && !stream->closed) {
+            pthread_cond_wait(&stream->freed_cond, &stream->lock);
+        }
+        int closed = stream->closed;
+        int slot   = stream->tail;
+        pthread_mutex_unlock(&stream->lock);
+        if (closed) {
+            break;
+        }
+
+        ssize_t size = (stream->format == COMPRESSION_GZIP)
+            ? readGzip(stream, stream->blocks[slot], STREAM_BLOCK_SIZE)
+            : readZstd(stream, stream->blocks[slot], STREAM_BLOCK_SIZE);
+
+        pthread_mutex_lock(&stream->lock);
+        if (size > 0) {
+            stream->sizes[slot] = size;
+            stream->tail        = (slot + 1) % STREAM_NUM_BLOCKS;
+            ++stream->num_filled;
+            --stream->num_free;
+        } else {
+            stream->eof   = 1;
+            stream->error = (size < 0);
+        }
+        pthread_cond_signal(&stream->filled_cond);
+        pthread_mutex_unlock(&stream->lock);
+        if (size <= 0) {
+            break;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * {@inheritDoc}
+ */
+InputStream* openInputStream(int fd, Compression format) {
+    InputStream* stream = malloc(sizeof(*stream));
+    memset(stream, 0, sizeof(*stream));
+    stream->format   = format;
+    stream->fd       = -1;
+    stream->child    = -1;
+    stream->num_free = STREAM_NUM_BLOCKS;
+    stream->current  = -1;
+    for (int slot = 0; slot < STREAM_NUM_BLOCKS; ++slot) {
+        stream->blocks[slot] = (char*) malloc(STREAM_HEADROOM + STREAM_BLOCK_SIZE) + STREAM_HEADROOM;
+    }
+
+    if (format == COMPRESSION_GZIP) {
+        stream->gz = gzdopen(dup(fd), "rb");
+        if (stream->gz == NULL) {
+            fprintf(stderr, "%s", invalid_compressed);
+            exit(1);
+        }
+        gzbuffer((gzFile) stream->gz, 1 << 17);
+    } else {
+#ifdef USE_LIBZSTD
+        ZstdState* state = malloc(sizeof(*state));
+        state->dstream    = ZSTD_createDStream();
+        state->capacity   = ZSTD_DStreamInSize();
+        state->data       = malloc(state->capacity);
+        state->input.src  = state->data;
+        state->input.size = 0;
+        state->input.pos  = 0;
+        state->eof        = 0;
+        ZSTD_initDStream(state->dstream);
+        stream->zstd = state;
+        stream->fd   = dup(fd);
+#else
+        /**
+         * Without libzstd, the zstd tool decompresses into a pipe
+         */
+        int pipe_fds[2];
+        if (pipe(pipe_fds) != 0) {
+            perror("pipe");
+            exit(1);
+        }
+        posix_spawn_file_actions_t actions;
+        posix_spawn_file_actions_init(&actions);
+        posix_spawn_file_actions_adddup2(&actions, fd, STDIN_FILENO);
+        posix_spawn_file_actions_adddup2(&actions, pipe_fds[1], STDOUT_FILENO);
+        posix_spawn_file_actions_addclose(&actions, pipe_fds[0]);
+        posix_spawn_file_actions_addclose(&actions, pipe_fds[1]);
+        char* argv[] = { "zstd", "-dcq", NULL };
+        if (posix_spawnp(&stream->child, "zstd", &actions, NULL, argv, environ) != 0) {
+            perror("zstd");
+            exit(1);
+        }
+        posix_spawn_file_actions_destroy(&actions);
+        close(pipe_fds[1]);
+        stream->fd = pipe_fds[0];
+#endif
+    }
+
+    pthread_mutex_init(&stream->lock, NULL);
+    pthread_cond_init(&stream->filled_cond, NULL);
+    pthread_cond_init(&stream->freed_cond, NULL);
+    pthread_create(&stream->thread, NULL, &decompressBlocks, (void*) stream);
+    return stream;
+}
+
+/**
+ * {@inheritDoc}
+ */
+int nextStreamWindow(InputStream* stream, const char** start, const char** end) {
+    for (;;) {
+        pthread_mutex_lock(&stream->lock);
+        while ((stream->num_filled == 0) && !stream->eof) {
+            pthread_cond_wait(&stream->filled_cond, &stream->lock);
+        }
+        int slot  = stream->head;
+        int ready = (stream->num_filled > 0);
+        int error = stream->error;
+        if (ready) {
+            stream->head = (slot + 1) % STREAM_NUM_BLOCKS;
+            --stream->num_filled;
+        }
+        pthread_mutex_unlock(&stream->lock);
+
+        /**
+         * Whatever was cut off the last block is the last window
+         */
+        if (!ready) {
+            if (error) {
+                fprintf(stderr, "%s", invalid_compressed);
+                exit(1);
+            }
+            if (stream->carry_bytes == 0) {
+                return 0;
+            }
+            *start = stream->carry;
+            *end   = stream->carry + stream->carry_bytes;
+            stream->carry_bytes = 0;
+            return 1;
+        }
+
+        /**
+         * Prepend the carried-over partial token, then release the old block
+         */
+        char* block  = stream->blocks[slot];
+        char* window = block - stream->carry_bytes;
+        memcpy(window, stream->carry, stream->carry_bytes);
+        if (stream->current >= 0) {
+            pthread_mutex_lock(&stream->lock);
+            ++stream->num_free;
+            pthread_cond_signal(&stream->freed_cond);
+            pthread_mutex_unlock(&stream->lock);
+        }
+        stream->current = slot;
+        stream->bytes  += stream->sizes[slot];
+
+        /**
+         * Cut the window back to its last whitespace
+         */
+        const char* block_end = block + stream->sizes[slot];
+        const char* cut       = block_end;
+        while ((cut > block) && (cut[-1] != ' ') && (cut[-1] != '\n') && (cut[-1] != '\t') && (cut[-1] != '\r')) {
+            --cut;
+        }
+        if (cut == block) {
+            cut = window;
+        }
+        if (block_end - cut > STREAM_HEADROOM) {
+            fprintf(stderr, "%s", invalid_format);
+            exit(1);
+        }
+        stream->carry       = cut;
+        stream->carry_bytes = block_end - cut;
+        if (cut > window) {
+            *start = window;
+            *end   = cut;
+            return 1;
+        }
+    }
+}
+
+/**
+ * {@inheritDoc}
+ */
+void closeInputStream(InputStream* stream) {
+    pthread_mutex_lock(&stream->lock);
+    stream->closed = 1;
+    pthread_cond_signal(&stream->freed_cond);
+    pthread_mutex_unlock(&stream->lock);
+    pthread_join(stream->thread, NULL);
+
+    if (stream->gz != NULL) {
+        gzclose((gzFile) stream->gz);
+    }
+    if (stream->fd >= 0) {
+        close(stream->fd);
+    }
+    if (stream->child > 0) {
+        waitpid(stream->child, NULL, 0);
+    }
+#ifdef USE_LIBZSTD
+    if (stream->zstd != NULL) {
+        ZstdState* state = (ZstdState*) stream->zstd;
+        ZSTD_freeDStream(state->dstream);
+        free(state->data);
+        free(state);
+    }
+#endif
+
+    for (int slot = 0; slot < STREAM_NUM_BLOCKS; ++slot) {
+        free(stream->blocks[slot] - STREAM_HEADROOM);
+    }
+    pthread_mutex_destroy(&stream->lock);
+    pthread_cond_destroy(&stream->filled_cond);
+    pthread_cond_destroy(&stream->freed_cond);
+    free(stream);
+}
@@ -0,0 +1,54 @@
+import sys
+
+# Neighbor entries beyond which offsets need a WIDE_OFFSETS=1 build
+MAX_NARROW_NHBRS = 2**32 - 1
+
+def nhbr_lines(y, x, rows, cols):
+    i = y * cols + x
+    top    = [i - cols] if y > 0 else []
+    bottom = [i + cols] if y < rows - 1 else []
+    left   = [i - 1] if x > 0 else []
+    right  = [i + 1] if x < cols - 1 else []
+    return ''.join(f'{len(nhbrs)} {" ".join(map(str, nhbrs))}\n' for nhbrs in (top, bottom, left, right))
+
+if __name__ == '__main__':
+    geometry = '--geometry' in sys.argv
+    if geometry:
+        sys.argv.remove('--geometry')
+
+    if len(sys.argv) != 4:
+        print(f'Usage: {sys.argv[0]} [rows] [cols] [input-file] [--geometry]')
+        print(f'rows:       number of rows')
+        print(f'cols:       number of columns')
+        print(f'input-file: path of output, which is an input file as described in assignments ("-" for stdout)')
+        print(f'--geometry: write box geometry only, leaving neighbors to the reader')
+        print(f'Writes a uniform grid of 1x1 boxes, e.g. 33000 33000 for more than 4G neighbor entries')
+        exit()
+
+    rows    = int(sys.argv[1])
+    cols    = int(sys.argv[2])
+    in_file = sys.argv[3]
+
+    num_boxes = rows * cols
+    num_nhbrs = 2 * (rows * (cols - 1) + cols * (rows - 1))
+    middle    = num_boxes // 2
+    print(f'{num_boxes} boxes, {num_nhbrs} neighbor entries'
+          + (' (needs a WIDE_OFFSETS=1 build)' if num_nhbrs > MAX_NARROW_NHBRS else ''),
+          file=sys.stderr)
+
+    out_file = sys.stdout if in_file == '-' else open(in_file, 'w')
+    with out_file:
+        if geometry:
+            out_file.write('geometry\n')
+        out_file.write(f'{num_boxes} {rows} {cols}\n')
+        for y in range(rows):
+            records = []
+            for x in range(cols):
+                i = y * cols + x
+                records.append(f'\n{i}\n{y} {x} 1 1\n')
+                if not geometry:
+                    records.append(nhbr_lines(y, x, rows, cols))
+                records.append('100\n' if i == middle else '0\n')
+            out_file.write(''.join(records))
+        out_file.write('\n')
+        out_file.write('-1\n')
@@ -56,9 +56,14 @@ def gen_boxes():
     return (rows, cols, boxes)
 
 if __name__ == '__main__':
+    geometry = '--geometry' in sys.argv
+    if geometry:
+        sys.argv.remove('--geometry')
+
     if len(sys.argv) != 2:
-        print(f'Usage: {sys.argv[0]} [input-file]')
+        print(f'Usage: {sys.argv[0]} [input-file] [--geometry]')
         print(f'input-file: path of output, which is an input file as described in assignments')
+        print(f'--geometry: write box geometry only, leaving neighbors to the reader')
         exit()
 
     in_file = sys.argv[1]
@@ -74,16 +79,19 @@ if __name__ == '__main__':
     boxes[len(boxes) // 2].v = 100
 
     with open(in_file, 'w') as out_file:
+        if geometry:
+            out_file.write('geometry\n')
         out_file.write(f'{len(boxes)} {rows} {cols}\n')
         for i, box in enumerate(boxes):
             out_file.write('\n')
             out_file.write(f'{i}\n')
             out_file.write(f'{box.y} {box.x} {box.h} {box.w}\n')
-            top, bottom, left, right = get_nhbrs(box, ids, rows, cols)
-            out_file.write(f'{len(top)} {" ".join(map(str, top))}\n')
-            out_file.write(f'{len(bottom)} {" ".join(map(str, bottom))}\n')
-            out_file.write(f'{len(left)} {" ".join(map(str, left))}\n')
-            out_file.write(f'{len(right)} {" ".join(map(str, right))}\n')
+            if not geometry:
+                top, bottom, left, right = get_nhbrs(box, ids, rows, cols)
+                out_file.write(f'{len(top)} {" ".join(map(str, top))}\n')
+                out_file.write(f'{len(bottom)} {" ".join(map(str, bottom))}\n')
+                out_file.write(f'{len(left)} {" ".join(map(str, left))}\n')
+                out_file.write(f'{len(right)} {" ".join(map(str, right))}\n')
             out_file.write(f'{box.v}\n')
         out_file.write('\n')
         out_file.write('-1\n')